@@ -0,0 +1,247 @@
+'''
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+'''
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+import os, sys
+import json
+import shutil
+import argparse
+import tempfile
+import resource
+import subprocess
+import timeit
+import numpy as np
+
+import memsurfer
+
+# ------------------------------------------------------------------------------
+# This script measures the end-to-end throughput of the workflow in ex_3lipid.py
+# on the same data: for every frame, both leaflets are computed, followed by
+# densities (type 2, 4 sigmas, all lipids and each of the 3 species), thickness,
+# and writing of all outputs (to a temporary directory).
+#
+# The data contains a single frame, which is replayed (with a small jitter) for
+# the requested number of frames. To measure larger systems, the box is tiled
+# in xy, e.g., --replicate 16 gives a 4x4 tiling (16 times the lipids).
+#
+# The results (frames/s, time per stage, and peak RSS) are reported as json.
+# Every replication factor is run in a separate process for a clean peak RSS.
+#   usage: python bench_3lipid.py [--replicate 1 4 16] [--frames 3] [--output f.json]
+#
+# Unlike ex_3lipid.py, this script does not need MDAnalysis: the leaflets are
+# identified by the orientation of every lipid (head above its tail = top).
+# ------------------------------------------------------------------------------
+
+DATA = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                    'data', '10us.35fs-DPPC.40-DIPC.30-CHOL.30.gro')
+
+LIPIDS = ['DIPC', 'DPPC', 'CHOL']
+SIGMAS = [10, 20, 30, 40]
+
+# the headgroup bead (as in lipidType.py) and the tail-end beads of each lipid
+HEADS = {'DIPC': 'NC3', 'DPPC': 'NC3', 'CHOL': 'ROH'}
+TAILS = {'DIPC': ['C4A', 'C4B'], 'DPPC': ['C4A', 'C4B'], 'CHOL': ['C2']}
+
+STAGES = ['pnormals', 'poisson', 'surface', 'properties', 'densities', 'thickness', 'write']
+
+# ------------------------------------------------------------------------------
+# read the headgroups of a .gro file (converted to Angstrom, as in MDAnalysis)
+# ------------------------------------------------------------------------------
+def read_gro_headgroups(fname):
+
+    with open(fname, 'r') as f:
+        lines = f.readlines()
+
+    natoms = int(lines[1])
+    box = 10. * np.array([float(v) for v in lines[2+natoms].split()[:3]])
+
+    heads, tails, names, top = [], [], [], []
+
+    # a residue is a run of consecutive atoms with the same (resid, resname)
+    key, head, tail = None, None, []
+    for line in lines[2:2+natoms] + ['']:
+
+        rkey = (line[0:5], line[5:10].strip()) if line else None
+        if rkey != key:
+            if head is not None and len(tail) > 0:
+                heads.append(head)
+                names.append(key[1])
+                top.append(head[2] > np.mean(tail))
+            key, head, tail = rkey, None, []
+
+        if not line or key[1] not in HEADS:
+            continue
+
+        aname = line[10:15].strip()
+        pos = 10. * np.array([float(line[20:28]), float(line[28:36]), float(line[36:44])])
+        if aname == HEADS[key[1]]:
+            head = pos
+        elif aname in TAILS[key[1]]:
+            tail.append(pos[2])
+
+    heads = np.array(heads, dtype=np.float32)
+    names = np.array(names)
+    top = np.array(top)
+    return (heads[top], names[top]), (heads[~top], names[~top]), box
+
+# ------------------------------------------------------------------------------
+# tile a leaflet (nx x ny times) in xy
+# ------------------------------------------------------------------------------
+def tiles_for(factor):
+
+    # the most square tiling with nx * ny = factor
+    nx = max(d for d in range(1, factor+1) if factor % d == 0 and d*d <= factor)
+    return nx, factor // nx
+
+def replicate(points, labels, box, nx, ny):
+
+    shifts = [(i*box[0], j*box[1], 0.) for i in range(nx) for j in range(ny)]
+    rpoints = np.concatenate([points + np.array(s, dtype=np.float32) for s in shifts])
+    rlabels = np.tile(labels, nx*ny)
+    return rpoints.astype(np.float32), rlabels
+
+# ------------------------------------------------------------------------------
+# the steps of Membrane.compute, timed separately
+# ------------------------------------------------------------------------------
+def compute_leaflet(points, labels, bbox, timings):
+
+    knbrs = 18
+
+    t0 = timeit.default_timer()
+    m = memsurfer.Membrane(points, labels=labels, periodic=True, bbox=bbox)
+    m.fit_points_to_box_xy()
+    m.compute_pnormals(knbrs)
+
+    t1 = timeit.default_timer()
+    m.compute_approx_surface()
+
+    t2 = timeit.default_timer()
+    m.compute_membrane_surface()
+
+    t3 = timeit.default_timer()
+    memsurfer.Membrane.compute_properties_concurrent([m], ('exact', 'smooth'))
+
+    t4 = timeit.default_timer()
+    timings['pnormals'] += t1-t0
+    timings['poisson'] += t2-t1
+    timings['surface'] += t3-t2
+    timings['properties'] += t4-t3
+    return m
+
+# ------------------------------------------------------------------------------
+# benchmark a single replication factor
+# ------------------------------------------------------------------------------
+def run(factor, nframes, jitter, seed):
+
+    (tpos, tlab), (bpos, blab), box = read_gro_headgroups(DATA)
+
+    nx, ny = tiles_for(factor)
+    tpos, tlab = replicate(tpos, tlab, box, nx, ny)
+    bpos, blab = replicate(bpos, blab, box, nx, ny)
+
+    bbox = np.zeros((2,3), dtype=np.float32)
+    bbox[1,:] = [nx*box[0], ny*box[1], box[2]]
+
+    timings = dict((s, 0.) for s in STAGES)
+    outdir = tempfile.mkdtemp(prefix='memsurfer_bench_')
+    np.random.seed(seed)
+
+    try:
+        tstart = timeit.default_timer()
+        for f in range(nframes):
+
+            # a new "frame"
+            tp = tpos + np.random.normal(0., jitter, tpos.shape).astype(np.float32)
+            bt = bpos + np.random.normal(0., jitter, bpos.shape).astype(np.float32)
+
+            mt = compute_leaflet(tp, tlab, bbox, timings)
+            mb = compute_leaflet(bt, blab, bbox, timings)
+
+            t0 = timeit.default_timer()
+            memsurfer.Membrane.compute_densities([mt, mb], [2], SIGMAS, True, 'all')
+            for l in LIPIDS:
+                memsurfer.Membrane.compute_densities([mt, mb], [2], SIGMAS, True, l)
+
+            t1 = timeit.default_timer()
+            memsurfer.Membrane.compute_thickness(mt, mb)
+
+            t2 = timeit.default_timer()
+            outprefix = os.path.join(outdir, 'f{}'.format(f))
+            mt.write_all(outprefix+'-top', {'frame': f, 'time': float(f)})
+            mb.write_all(outprefix+'-bot', {'frame': f, 'time': float(f)})
+
+            t3 = timeit.default_timer()
+            timings['densities'] += t1-t0
+            timings['thickness'] += t2-t1
+            timings['write'] += t3-t2
+
+        ttotal = timeit.default_timer() - tstart
+    finally:
+        shutil.rmtree(outdir, ignore_errors=True)
+
+    # ru_maxrss is in kilobytes on linux, but in bytes on macos
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    rss = rss / (1024.*1024.) if sys.platform == 'darwin' else rss / 1024.
+
+    return {'replicate': factor, 'tiles': [nx, ny],
+            'nlipids': [int(tpos.shape[0]), int(bpos.shape[0])],
+            'frames': nframes,
+            'seconds': ttotal,
+            'frames_per_sec': nframes / ttotal,
+            'stages_per_frame': dict((s, timings[s] / nframes) for s in STAGES),
+            'peak_rss_mb': rss}
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description='End-to-end throughput of the 3-lipid workflow')
+    parser.add_argument('--replicate', type=int, nargs='+', default=[1, 4, 16],
+                        help='number of copies of the box (tiled in xy)')
+    parser.add_argument('--frames', type=int, default=3, help='number of frames per run')
+    parser.add_argument('--jitter', type=float, default=0.1, help='jitter (in A) added to every frame')
+    parser.add_argument('--seed', type=int, default=0)
+    parser.add_argument('--output', type=str, default='', help='json file (default: stdout)')
+    args = parser.parse_args()
+
+    if any(f < 1 or f > 16 for f in args.replicate):
+        parser.error('--replicate should be between 1 and 16')
+
+    # a single factor is run in this process
+    if len(args.replicate) == 1:
+        results = [run(args.replicate[0], args.frames, args.jitter, args.seed)]
+
+    # otherwise, every factor is run in a new process
+    else:
+        results = []
+        for f in args.replicate:
+            fd, fname = tempfile.mkstemp(suffix='.json')
+            os.close(fd)
+            try:
+                subprocess.check_call([sys.executable, os.path.abspath(__file__),
+                                       '--replicate', str(f), '--frames', str(args.frames),
+                                       '--jitter', str(args.jitter), '--seed', str(args.seed),
+                                       '--output', fname])
+                with open(fname, 'r') as fp:
+                    results.extend(json.load(fp)['runs'])
+            finally:
+                os.remove(fname)
+
+    report = {'memsurfer': memsurfer.__file__, 'data': os.path.basename(DATA), 'runs': results}
+    if args.output:
+        with open(args.output, 'w') as fp:
+            json.dump(report, fp, indent=2)
+    else:
+        print (json.dumps(report, indent=2))
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
@@ -0,0 +1,83 @@
+'''
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+'''
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+import sys
+import numpy as np
+import timeit
+
+import memsurfer
+from memsurfer.trimesh import TriMesh
+
+# ------------------------------------------------------------------------------
+# This script compares the error-controlled dual-tree density estimation
+# (tolerance > 0) with the exact loop for density types 2 and 3: time, speedup,
+# and the maximum relative error, which must not exceed the tolerance.
+#   usage: python bench_kdetree.py [npoints ...]
+#   exits with 1 if the error bound is violated
+# ------------------------------------------------------------------------------
+def run_kde(points, box, dtype, sigma, tolerance, name):
+
+    mesh = TriMesh(points, periodic=True, label='bench')
+    mesh.set_bbox(box[0], box[1])
+
+    t0 = timeit.default_timer()
+    d = mesh.compute_density(dtype, sigma, name, False, np.empty([0]), False, tolerance)
+    t1 = timeit.default_timer()
+    return d, t1-t0
+
+if __name__ == '__main__':
+
+    print ('using memsurfer from ({})'.format(memsurfer.__file__))
+
+    sizes = [int(a) for a in sys.argv[1:]] if len(sys.argv) > 1 else [1000, 4000, 16000]
+    sigmas = [1.0, 4.0, 10.0]
+    tolerances = [1e-2, 1e-3, 1e-4]
+
+    print ('{:>8} {:>5} {:>6} {:>8} {:>10} {:>10} {:>8} {:>12} {:>4}'
+           .format('npoints', 'type', 'sigma', 'tol', 'exact (s)', 'tree (s)', 'speedup', 'max rel err', ''))
+
+    np.random.seed(0)
+    nviolated = 0
+    for n in sizes:
+
+        # a (roughly) constant areal density of points in a thin slab
+        w = np.sqrt(n / 0.015)
+        points = np.random.rand(n, 3).astype(np.float32) * np.array([w, w, 40.], dtype=np.float32)
+
+        for dtype in [2, 3]:
+
+            if dtype == 2:
+                p = np.ascontiguousarray(points[:,:2])
+                box = np.array([[0., 0.], [w, w]], dtype=np.float32)
+            else:
+                p = points
+                box = np.array([[0., 0., 0.], [w, w, 40.]], dtype=np.float32)
+
+            for s in sigmas:
+                de, te = run_kde(p, box, dtype, s, 0., 'exact')
+
+                for tol in tolerances:
+                    dt, tt = run_kde(p, box, dtype, s, tol, 'tree')
+
+                    err = np.max(np.abs(dt - de) / np.abs(de))
+                    ok = err <= tol
+                    nviolated += 0 if ok else 1
+                    print ('{:>8} {:>5} {:>6.1f} {:>8.0e} {:>10.3f} {:>10.3f} {:>8.2f} {:>12.3e} {:>4}'
+                           .format(n, dtype, s, tol, te, tt, te/tt, err, 'ok' if ok else 'FAIL'))
+
+    if nviolated > 0:
+        print ('error bound violated in {} case(s)!'.format(nviolated))
+        sys.exit(1)
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+'''
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+'''
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+import sys
+import numpy as np
+import timeit
+
+import memsurfer
+from memsurfer.trimesh import TriMesh
+
+# ------------------------------------------------------------------------------
+# This script compares the exact and the fast (approximate exp) Gaussian kernels
+# for density estimation: throughput (kernel evaluations per second) and the
+# maximum relative difference of the resulting densities.
+#   usage: python bench_kernels.py [npoints ...]
+# ------------------------------------------------------------------------------
+def run_kde(points, box, dtype, sigma, fast_exp, name):
+
+    mesh = TriMesh(points, periodic=True, label='bench')
+    mesh.set_bbox(box[0], box[1])
+
+    t0 = timeit.default_timer()
+    d = mesh.compute_density(dtype, sigma, name, False, np.empty([0]), fast_exp)
+    t1 = timeit.default_timer()
+    return d, t1-t0
+
+if __name__ == '__main__':
+
+    print ('using memsurfer from ({})'.format(memsurfer.__file__))
+
+    sizes = [int(a) for a in sys.argv[1:]] if len(sys.argv) > 1 else [1000, 4000, 16000]
+    sigmas = [1.0, 4.0, 10.0]
+
+    print ('{:>8} {:>6} {:>5} {:>12} {:>12} {:>8} {:>12}'
+           .format('npoints', 'sigma', 'type', 'exact (M/s)', 'fast (M/s)', 'speedup', 'max rel err'))
+
+    np.random.seed(0)
+    for n in sizes:
+
+        # a (roughly) constant areal density of points
+        w = np.sqrt(n / 0.015)
+        box = np.array([[0., 0.], [w, w]], dtype=np.float32)
+        points = np.random.rand(n, 2).astype(np.float32) * w
+
+        for s in sigmas:
+            de, te = run_kde(points, box, 2, s, False, 'exact')
+            df, tf = run_kde(points, box, 2, s, True, 'fast')
+
+            npairs = float(n) * float(n)
+            err = np.max(np.abs(df - de) / np.abs(de))
+            print ('{:>8} {:>6.1f} {:>5} {:>12.2f} {:>12.2f} {:>8.2f} {:>12.3e}'
+                   .format(n, s, 2, 1e-6*npairs/te, 1e-6*npairs/tf, te/tf, err))
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
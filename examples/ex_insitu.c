@@ -0,0 +1,128 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+//! ----------------------------------------------------------------------------
+//!
+//! \brief Smoke test of the in-situ C API (InSitu.h), as used by an MD engine
+//!
+//!     a host with two atoms per lipid (the first is the selected bead) pushes a
+//!     few frames of a wavy leaflet, and checks the per-lipid results of all but
+//!     the last frame, which is left for ms_destroy() to release
+//!
+//!     built and run by: python setup.py build_insitu --test
+//!     returns 0 on success
+//!
+//! ----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "InSitu.h"
+
+#define M       24          // lipids per side of the grid
+#define NFRAMES 4
+
+static int check(int cond, const char *msg, long step) {
+    if (!cond)
+        fprintf(stderr, " ERROR: ex_insitu: %s (step %ld)!\n", msg, step);
+    return cond;
+}
+
+int main(void) {
+
+    const int n = M*M;
+    const int natoms = 2*n;
+    const float spacing = 0.8f;
+
+    int *selected = (int*) malloc(n*sizeof(int));
+    int *labels = (int*) malloc(n*sizeof(int));
+    float *coords = (float*) malloc(3*natoms*sizeof(float));
+    for(int i = 0; i < n; i++) {
+        selected[i] = 2*i;
+        labels[i] = i % 2;
+    }
+
+    ms_set_numa(1, 0);
+
+    ms_context *ctx = ms_create(0, NULL, natoms, n, selected, labels, 2, 2);
+    if (ctx == NULL) {
+        fprintf(stderr, " ERROR: ex_insitu: ms_create() failed!\n");
+        return 1;
+    }
+
+    const int col = ms_add_density(ctx, 1.0f, 0);
+    int ok = check(col == MS_DENSITY, ms_last_error(ctx), -1);
+    ok &= check(ms_set_smoothing(ctx, 5, 0.5f, -0.53f) == 0, ms_last_error(ctx), -1);
+
+    const int nvalues = ms_nvalues(ctx);
+    ok &= check(nvalues == MS_DENSITY+1, "unexpected number of values", -1);
+
+    // -------------------------------------------------------------------------
+    // push the frames (a jittered grid with a growing wave in z)
+    for(long step = 0; step < NFRAMES; step++) {
+        for(int i = 0; i < n; i++) {
+            const int x = i % M, y = i / M;
+            float *p = &coords[6*i];
+            p[0] = spacing*(x + 0.1f*sinf(1.7f*i));
+            p[1] = spacing*(y + 0.1f*cosf(2.3f*i));
+            p[2] = 0.2f*step*sinf(0.3f*x);
+            p[3] = p[0];    p[4] = p[1];    p[5] = p[2] - 1.0f;
+        }
+        ok &= check(ms_push(ctx, step, coords, NULL) == 0, ms_last_error(ctx), step);
+    }
+
+    ok &= check(ms_add_density(ctx, 1.0f, 1) == -1, "configured after the first push", -1);
+    ok &= check(ms_wait(ctx, -1) == 0, ms_last_error(ctx), -1);
+
+    // -------------------------------------------------------------------------
+    // check the results (the last frame is not retrieved)
+    float *out = (float*) malloc(n*nvalues*sizeof(float));
+    ok &= check(ms_get_results(ctx, 0, out, nvalues) == -1, "accepted a short buffer", 0);
+
+    for(long step = 0; step < NFRAMES-1; step++) {
+
+        if (!check(ms_get_results(ctx, step, out, n*nvalues) == 0, ms_last_error(ctx), step)) {
+            ok = 0;
+            continue;
+        }
+
+        double area = 0;
+        int valid = 1;
+        for(int i = 0; i < n; i++) {
+            const float *v = &out[i*nvalues];
+            const double nlen = sqrt(v[MS_NORMAL_X]*v[MS_NORMAL_X] + v[MS_NORMAL_Y]*v[MS_NORMAL_Y] + v[MS_NORMAL_Z]*v[MS_NORMAL_Z]);
+            valid &= (v[MS_AREA] > 0 && fabs(nlen - 1.0) < 1e-3 && v[col] >= 0 && !isnan(v[col]));
+            area += v[MS_AREA];
+        }
+
+        // the surface covers about the extent of the grid (the wave adds a little)
+        const double planar = (spacing*(M-1)) * (spacing*(M-1));
+        ok &= check(valid, "invalid area, normal, or density", step);
+        ok &= check(area > 0.9*planar && area < 2.0*planar, "unexpected total area", step);
+        printf(" ex_insitu: step %ld: area = %.3f (planar %.3f)\n", step, area, planar);
+    }
+
+    ok &= check(ms_get_results(ctx, 0, out, n*nvalues) == -1, "results were not released", 0);
+    ok &= check(ms_get_results(ctx, NFRAMES, out, n*nvalues) == -1, "unknown step was accepted", NFRAMES);
+
+    ms_destroy(ctx);
+    free(out);
+    free(coords);
+    free(labels);
+    free(selected);
+
+    printf(" ex_insitu: %s\n", ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -13,3 +13,6 @@ For details, see https://github.com/LLNL/MemSurfer.
 # ------------------------------------------------------------------------------
 
 from .membrane import Membrane
+from .accumulator import FieldAccumulator
+from .contacts import ContactLifetimes
+from .diffusion import LateralDiffusion
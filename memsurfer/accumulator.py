@@ -0,0 +1,122 @@
+'''
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+'''
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+
+import os
+import numpy as np
+import logging
+LOGGER = logging.getLogger(__name__)
+
+from . import pymemsurfer
+from .utils import Timer
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+class FieldAccumulator(object):
+    '''
+       Class to average fields over many frames on a fixed reference grid
+       (in the parameterized plane), keeping only running mean and variance
+    '''
+
+    # --------------------------------------------------------------------------
+    # constructor
+    def __init__(self, bbox, shape, **kwargs):
+        '''
+        bbox:  ndarray of shape (2,2) or (2,3): the reference box (only xy is used)
+        shape: (nx, ny): number of grid samples along x and y
+        kwargs:
+                checkpoint: filename to resume from (if it exists)
+                label:      label for this accumulator
+        '''
+        bbox = np.asarray(bbox, dtype=np.float32)
+        if bbox.shape[0] != 2 or bbox.shape[1] < 2:
+            raise ValueError('FieldAccumulator needs a bounding box: ndarray (2, 2/3)')
+
+        self.bbox = np.array([bbox[0,0], bbox[0,1], bbox[1,0], bbox[1,1]], dtype=np.float32)
+        self.shape = (int(shape[0]), int(shape[1]))
+        self.label = kwargs.get('label', 'FieldAccumulator')
+        self.cverbose = LOGGER.isEnabledFor(logging.DEBUG)
+
+        self.acc = pymemsurfer.FieldAccumulator(self.bbox, self.shape[0], self.shape[1])
+
+        checkpoint = kwargs.get('checkpoint', '')
+        if len(checkpoint) > 0 and os.path.isfile(checkpoint):
+            self.load(checkpoint)
+
+        LOGGER.info('{} Created {} x {} grid in {}'.format(self.tag(), self.shape[0], self.shape[1], self.bbox))
+
+    # --------------------------------------------------------------------------
+    def tag(self):
+        return '[{}]'.format(self.label)
+
+    def names(self):
+        return list(self.acc.names())
+
+    def nframes(self, name):
+        return self.acc.nframes(name)
+
+    # --------------------------------------------------------------------------
+    def _grid(self, data, dtype=np.float32):
+        return np.asarray(data, dtype=dtype).reshape(self.shape[1], self.shape[0])
+
+    def mean(self, name):
+        return self._grid(self.acc.mean(name))
+
+    def variance(self, name):
+        return self._grid(self.acc.variance(name))
+
+    def count(self, name):
+        return self._grid(self.acc.count(name), np.int32)
+
+    # --------------------------------------------------------------------------
+    def add_membrane(self, m, names, fields={}):
+        '''
+            Accumulate one frame of a membrane
+                names:  names of the fields computed on memb_smooth (e.g., densities)
+                fields: additional per-vertex fields, {name: ndarray (npoints,)}
+        '''
+        names = list(names)
+        for k, v in fields.items():
+            v = np.ascontiguousarray(v, dtype=np.float32).reshape(-1,1)
+            if v.shape[0] != m.memb_smooth.nverts:
+                raise ValueError('Field ({}) has {} values, expected {}'.format(k, v.shape[0], m.memb_smooth.nverts))
+            m.memb_smooth.tmesh.set_field(k, v)
+            names.append(k)
+
+        LOGGER.info('{} Accumulating {} fields'.format(self.tag(), len(names)))
+        mtimer = Timer()
+        self.acc.accumulate(m.memb_planar.tmesh, m.memb_smooth.tmesh, names, self.cverbose)
+        mtimer.end()
+        LOGGER.info('{} Accumulated! took {}'.format(self.tag(), mtimer))
+
+    def add_grid(self, name, values):
+        '''
+            Accumulate one frame of a field already sampled on the grid
+                values: ndarray (ny, nx) (nan = missing)
+        '''
+        values = np.ascontiguousarray(values, dtype=np.float32).reshape(-1)
+        self.acc.accumulate_grid(name, values)
+
+    # --------------------------------------------------------------------------
+    def save(self, filename):
+        if not self.acc.save(filename, self.cverbose):
+            raise IOError('Failed to write checkpoint ({})'.format(filename))
+        LOGGER.info('{} Wrote checkpoint ({})'.format(self.tag(), filename))
+
+    def load(self, filename):
+        if not self.acc.load(filename, self.cverbose):
+            raise IOError('Failed to read checkpoint ({})'.format(filename))
+        LOGGER.info('{} Resumed from checkpoint ({}): {}'.format(self.tag(), filename, self.names()))
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
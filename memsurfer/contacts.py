@@ -0,0 +1,119 @@
+'''
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+'''
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+
+import numpy as np
+import logging
+LOGGER = logging.getLogger(__name__)
+
+from . import pymemsurfer
+from .utils import Timer
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+class ContactLifetimes(object):
+    '''
+       Class to accumulate the lifetimes of nearest-neighbor contacts (the edges
+       of the planar Delaunay mesh) per pair of lipid species, over many frames
+    '''
+
+    # --------------------------------------------------------------------------
+    # constructor
+    def __init__(self, labels, nbins=1000, **kwargs):
+        '''
+        labels: ndarray of shape (nlipids,): species of every lipid
+                    a lipid is identified by its index in labels
+        nbins:  number of lifetime bins (in frames); the last bin also counts
+                    all longer contacts
+        kwargs:
+                label:  label for this object
+        '''
+        labels = np.asarray(labels)
+        if len(labels.shape) != 1 or labels.shape[0] == 0:
+            raise ValueError('ContactLifetimes needs one label per lipid')
+
+        self.species, sids = np.unique(labels, return_inverse=True)
+        self.nlipids = labels.shape[0]
+        self.label = kwargs.get('label', 'ContactLifetimes')
+        self.cverbose = LOGGER.isEnabledFor(logging.DEBUG)
+
+        self.clt = pymemsurfer.ContactLifetimes(sids.astype(np.int32), int(nbins))
+
+        LOGGER.info('{} Created for {} lipids of {} species: {}'
+                    .format(self.tag(), self.nlipids, len(self.species), list(self.species)))
+
+    # --------------------------------------------------------------------------
+    def tag(self):
+        return '[{}]'.format(self.label)
+
+    def nframes(self):
+        return self.clt.nframes()
+
+    def _sid(self, s):
+        idx = np.where(self.species == s)[0]
+        if len(idx) == 0:
+            raise ValueError('Unknown species ({}). Should be one of {}'.format(s, list(self.species)))
+        return int(idx[0])
+
+    # --------------------------------------------------------------------------
+    def add_membrane(self, m, ids=None):
+        '''
+            Add the contacts of one frame of a membrane
+                ids: ndarray (npoints,): lipid index of every point of m
+                        (default: point i is lipid i)
+        '''
+        if ids is None:
+            ids = np.empty(0, dtype=np.int32)
+        else:
+            ids = np.ascontiguousarray(ids, dtype=np.int32)
+            if ids.shape[0] != m.npoints:
+                raise ValueError('Got {} ids for {} points'.format(ids.shape[0], m.npoints))
+
+        mtimer = Timer()
+        self.clt.add_frame(m.memb_planar.tmesh, ids, self.cverbose)
+        mtimer.end()
+        LOGGER.info('{} Added frame {} with {} contacts! took {}'
+                    .format(self.tag(), self.nframes()-1, self.clt.ncontacts(), mtimer))
+
+    # --------------------------------------------------------------------------
+    def histogram(self, a, b):
+        '''
+            Number of contacts between species a and b that lasted k+1 frames
+        '''
+        return np.array(self.clt.histogram(self._sid(a), self._sid(b)), dtype=np.int64)
+
+    def active(self, a, b):
+        '''
+            Ages (in frames) of the contacts between a and b that have not ended
+        '''
+        return np.array(self.clt.active(self._sid(a), self._sid(b)), dtype=np.int64)
+
+    def exchanges(self, a, b):
+        '''
+            Number of contacts between a and b that were formed, broken,
+            and broken without a known start (present in the first frame)
+        '''
+        sa, sb = self._sid(a), self._sid(b)
+        return {'formed': self.clt.formed(sa, sb),
+                'broken': self.clt.broken(sa, sb),
+                'censored': self.clt.censored(sa, sb)}
+
+    def pairs(self):
+        '''
+            All (unordered) species pairs
+        '''
+        n = len(self.species)
+        return [(self.species[i], self.species[j]) for i in range(n) for j in range(i, n)]
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
@@ -0,0 +1,377 @@
+'''
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+'''
+
+# ------------------------------------------------------------------------------
+# This file provides a domain-decomposed computation of mesh properties
+#
+#   the (periodic) box is split into nx x ny tiles in xy, and each tile is
+#   processed by a separate worker process. a worker owns the vertices in its
+#   tile, and builds its meshes only over them and the few it needs around:
+#       normals, point areas: the faces (incl. the trimmed periodic faces, over
+#           the duplicated vertices) incident on the owned vertices
+#       curvatures: the interior faces incident on the owned vertices
+#       densities: the owned vertices and a halo of the vertices within the
+#           support of the kernel, i.e., where it falls below cutoff * kernel(0),
+#           of the tile (in periodic xy). the geodesic density (type 1) also
+#           includes the faces touching the halo: a geodesic path shorter than
+#           the radius of the halo never leaves it, so all geodesic distances
+#           within the support are the same as on the whole mesh
+#   the memory of a worker is therefore proportional to its tile and its halo,
+#   e.g., the all-pairs geodesic distances of type 1 are computed per tile.
+#
+#   the inputs (vertices, faces) and the outputs (one row per vertex) live in
+#   POSIX shared memory. workers attach to them by name, and write only the
+#   rows of the vertices they own.
+#
+#   the faces are kept in their global order and the local vertices in
+#   increasing global order, and the native face loops gather in the order of
+#   the faces, so the stitched normals, point areas, and curvatures match the
+#   single-process computation exactly (for any number of threads). densities
+#   omit the sources beyond the halo, i.e., differ by (about) the cutoff
+#   relative to the density, and match exactly if cutoff = 0 (the halo is the
+#   whole box). densities are limited to the exact types 1, 2, and 3 (no
+#   tolerance or knn), and get_nlipids is applied globally.
+#
+#   requires Python 3.8 (multiprocessing.shared_memory)
+# ------------------------------------------------------------------------------
+
+import numpy as np
+import logging
+import multiprocessing as mp
+LOGGER = logging.getLogger(__name__)
+
+from .trimesh import TriMesh
+from .utils import Timer
+
+# ------------------------------------------------------------------------------
+# shared memory utils
+# ------------------------------------------------------------------------------
+def _shm_create(shape, dtype, data=None):
+
+    from multiprocessing import shared_memory
+
+    dtype = np.dtype(dtype)
+    nbytes = max(1, int(np.prod(shape)) * dtype.itemsize)
+    shm = shared_memory.SharedMemory(create=True, size=nbytes)
+
+    arr = np.ndarray(shape, dtype=dtype, buffer=shm.buf)
+    if data is not None:
+        arr[...] = data
+    else:
+        arr.fill(0)
+    return shm, {'name': shm.name, 'shape': tuple(shape), 'dtype': dtype.str}
+
+
+def _shm_attach(desc):
+
+    from multiprocessing import shared_memory, resource_tracker
+
+    shm = shared_memory.SharedMemory(name=desc['name'])
+
+    # the launcher owns (and unlinks) the segment, the workers should not
+    try:
+        resource_tracker.unregister(shm._name, 'shared_memory')
+    except Exception:
+        pass
+
+    arr = np.ndarray(desc['shape'], dtype=np.dtype(desc['dtype']), buffer=shm.buf)
+    return shm, arr
+
+# ------------------------------------------------------------------------------
+# tiling
+# ------------------------------------------------------------------------------
+def _tile_ids(xy, bb0, boxw, tiles):
+
+    t = np.floor((xy - bb0) / boxw * tiles).astype(np.int64)
+    t = np.clip(t, 0, np.array(tiles)-1)
+    return t[:,1] * tiles[0] + t[:,0]
+
+
+def _local_mesh(verts, faces, owned, label):
+    '''
+        the faces (in global order) incident on the owned vertices, over their
+        vertices and the owned ones (in global order), and the local ids of the owned
+    '''
+    is_owned = np.zeros(verts.shape[0], dtype=bool)
+    is_owned[owned] = True
+
+    lfaces = faces[np.any(is_owned[faces], axis=1)]
+    gids = np.union1d(lfaces.reshape(-1), owned)
+
+    lmap = np.full(verts.shape[0], -1, dtype=np.int64)
+    lmap[gids] = np.arange(gids.shape[0])
+
+    mesh = TriMesh(verts[gids], faces=lmap[lfaces].astype(np.uint32), label=label)
+    return mesh, lmap[owned]
+
+
+def _halo(xy, owned, t, params, sigma):
+    '''
+        the owned vertices and those within the support of the kernel of the
+        tile t (in periodic xy), in global order
+    '''
+    if params['cutoff'] <= 0.:
+        return np.arange(xy.shape[0])
+
+    # the square radius where the (Gaussian) kernel falls below cutoff * kernel(0)
+    radius2 = -2. * sigma * sigma * np.log(params['cutoff'])
+
+    tiles, bb0, boxw = params['tiles'], params['bb0'], params['boxw']
+    tw = boxw / np.array(tiles)
+    center = bb0 + (np.array([t % tiles[0], t // tiles[0]]) + 0.5) * tw
+
+    d = np.abs(xy.astype(np.float64) - center)
+    if params['periodic']:
+        d = np.mod(d, boxw)
+        d = np.minimum(d, boxw - d)
+    d = np.maximum(d - 0.5*tw, 0.)
+
+    return np.union1d(np.where(np.sum(d*d, axis=1) <= radius2)[0], owned)
+
+
+def _halo_faces(gids, faces, nverts):
+    '''
+        the halo grown by the faces touching it (so that all edges among its
+        vertices are kept), and these faces (in global order)
+    '''
+    is_halo = np.zeros(nverts, dtype=bool)
+    is_halo[gids] = True
+
+    lfaces = faces[np.any(is_halo[faces], axis=1)]
+    return np.union1d(gids, lfaces.reshape(-1)), lfaces
+
+
+def _process_tile(t, arrays, params):
+
+    verts, faces, tfaces, dverts = arrays['vertices'], arrays['faces'], arrays['tfaces'], arrays['dverts']
+
+    owned = np.where(arrays['tids'] == t)[0]
+    if owned.shape[0] == 0:
+        return (t, 0)
+
+    label = 'tile_{}'.format(t)
+
+    # normals and point areas use all faces (incl. the trimmed ones, over the duplicated vertices)
+    if params['normals']:
+        averts = verts if dverts.shape[0] == 0 else np.concatenate((verts, dverts))
+        afaces = faces if tfaces.shape[0] == 0 else np.concatenate((faces, tfaces))
+        mesh, lowned = _local_mesh(averts, afaces, owned, label)
+
+        arrays['normals'][owned] = mesh.compute_normals()[lowned]
+        arrays['pareas'][owned] = mesh.compute_pointareas()[lowned]
+
+    # curvature (as the global mesh) uses only the interior faces
+    if params['curvature']:
+        cmesh, lowned = _local_mesh(verts, faces, owned, label)
+
+        (mc, gc) = cmesh.compute_curvatures()
+        arrays['mean_curv'][owned] = mc[lowned]
+        arrays['gaus_curv'][owned] = gc[lowned]
+
+    # densities of the sources in the halo of the tile, evaluated only at the owned vertices
+    for i, d in enumerate(params['densities']):
+
+        gids = _halo(verts[:,:2], owned, t, params, d['sigma'])
+
+        lfaces = None
+        if d['type'] == 1:
+            gids, lfaces = _halo_faces(gids, arrays['gfaces'], verts.shape[0])
+
+        lmap = np.full(verts.shape[0], -1, dtype=np.int64)
+        lmap[gids] = np.arange(gids.shape[0])
+
+        if lfaces is None:
+            dmesh = TriMesh(verts[gids], periodic=params['periodic'], label=label)
+        else:
+            dmesh = TriMesh(verts[gids], faces=lmap[lfaces].astype(np.uint32),
+                            periodic=params['periodic'], label=label)
+        if params['periodic']:
+            dmesh.set_bbox(params['bbox'][0], params['bbox'][1])
+        if d['type'] != 1:
+            dmesh.set_roi_vertices(lmap[owned])
+
+        sources = np.empty([0])
+        if 'pidxs' in d:
+            sources = np.where(arrays['pidxs_{}'.format(i)][gids])[0]
+
+        dens = dmesh.compute_density(d['type'], d['sigma'], d['name'], False, sources,
+                                     d.get('fast_exp', False))[lmap[owned]]
+
+        # the kernels are normalized by the number of (local) vertices
+        if gids.shape[0] != verts.shape[0]:
+            dens = (dens.astype(np.float64) * gids.shape[0] / verts.shape[0]).astype(np.float32)
+        arrays['density_{}'.format(i)][owned] = dens
+
+    return (t, owned.shape[0])
+
+
+def _tile_worker(args):
+
+    (t, desc, params) = args
+    handles, arrays = {}, {}
+    try:
+        for k, d in desc.items():
+            handles[k], arrays[k] = _shm_attach(d)
+        return _process_tile(t, arrays, params)
+
+    finally:
+        # views into the segments must be released before closing them
+        arrays.clear()
+        for h in handles.values():
+            try:
+                h.close()
+            except BufferError:
+                pass
+
+# ------------------------------------------------------------------------------
+# launcher
+# ------------------------------------------------------------------------------
+def compute_properties_decomposed(vertices, faces, tfaces, dverts, bbox, periodic,
+                                  tiles=(2,2), densities=[], nprocs=None,
+                                  normals=True, curvature=True, pfaces=None, cutoff=1e-7):
+    '''
+        vertices:   ndarray (nverts, 3)
+        faces:      ndarray (nfaces, 3), faces inside the domain
+        tfaces:     ndarray (ntfaces, 3), trimmed faces across the periodic boundary,
+                        over the vertices followed by dverts (may be empty)
+        dverts:     ndarray (ndverts, 3), the duplicated vertices (may be empty)
+        bbox:       ndarray (2, 2/3), the (periodic) box, as given to the mesh
+        tiles:      number of tiles along x and y
+        densities:  list of dicts with keys
+                        name, type (1/2/3), sigma, get_nlipids,
+                        pidxs (optional, sorted), fast_exp (optional)
+        nprocs:     number of worker processes (default: number of tiles)
+        pfaces:     ndarray (npfaces, 3), faces across the periodic boundary, over
+                        the vertices (needed for the geodesic density, if periodic)
+        cutoff:     relative value of the kernel beyond which the sources are
+                        omitted, i.e., the size of the halos (0: the whole box)
+
+        returns a dictionary of per-vertex properties
+    '''
+    mtimer = Timer()
+
+    # only the exact sums can be decomposed
+    for d in densities:
+        if d['type'] not in [1, 2, 3]:
+            raise ValueError('Decomposed density supports types 1, 2, and 3 (got {}). Use compute_density'
+                             .format(d['type']))
+        if d['type'] == 1 and periodic and pfaces is None:
+            raise ValueError('Decomposed geodesic density of a periodic mesh needs the periodic faces (pfaces)')
+        if d.get('tolerance', 0.) > 0. or d.get('knn', 0) > 0:
+            raise ValueError('Decomposed density does not support tolerance or knn (got {}, {}). Use compute_density'
+                             .format(d.get('tolerance', 0.), d.get('knn', 0)))
+
+    vertices = np.ascontiguousarray(vertices, dtype=np.float32)
+    faces = np.ascontiguousarray(faces, dtype=np.uint32).reshape(-1,3)
+    tfaces = np.ascontiguousarray(tfaces, dtype=np.uint32).reshape(-1,3)
+    dverts = np.ascontiguousarray(dverts, dtype=np.float32).reshape(-1,vertices.shape[1])
+    bbox = np.asarray(bbox, dtype=np.float32)
+    if not (0. <= cutoff < 1.):
+        raise ValueError('Invalid cutoff, {}. Should be in [0, 1)'.format(cutoff))
+
+    nverts = vertices.shape[0]
+    tiles = (int(tiles[0]), int(tiles[1]))
+    ntiles = tiles[0] * tiles[1]
+
+    bb0 = bbox[0,:2].astype(np.float64)
+    boxw = (bbox[1,:2] - bbox[0,:2]).astype(np.float64)
+
+    tids = _tile_ids(vertices[:,:2].astype(np.float64), bb0, boxw, np.array(tiles))
+
+    LOGGER.info('Decomposing {} vertices into {} x {} tiles'.format(nverts, tiles[0], tiles[1]))
+
+    # --------------------------------------------------------------------------
+    # shared memory: inputs and outputs
+    shms, desc = {}, {}
+
+    def share(key, shape, dtype, data=None):
+        shms[key], desc[key] = _shm_create(shape, dtype, data)
+
+    try:
+        share('vertices', vertices.shape, np.float32, vertices)
+        share('faces', faces.shape, np.uint32, faces)
+        share('tfaces', tfaces.shape, np.uint32, tfaces)
+        share('dverts', dverts.shape, np.float32, dverts)
+        share('tids', tids.shape, np.int64, tids)
+
+        # the geodesic density walks over all faces (incl. the periodic ones)
+        if any(d['type'] == 1 for d in densities):
+            gfaces = faces
+            if periodic:
+                gfaces = np.concatenate((faces, np.asarray(pfaces, dtype=np.uint32).reshape(-1,3)))
+            share('gfaces', gfaces.shape, np.uint32, gfaces)
+
+        if normals:
+            share('normals', (nverts, 3), np.float32)
+            share('pareas', (nverts,), np.float32)
+        if curvature:
+            share('mean_curv', (nverts,), np.float32)
+            share('gaus_curv', (nverts,), np.float32)
+
+        dparams = []
+        for i, d in enumerate(densities):
+            dp = {k: v for k, v in d.items() if k != 'pidxs'}
+            if 'pidxs' in d and len(d['pidxs']) > 0:
+                mask = np.zeros(nverts, dtype=bool)
+                mask[np.asarray(d['pidxs'], dtype=np.int64)] = True
+                share('pidxs_{}'.format(i), (nverts,), bool, mask)
+                dp['pidxs'] = True
+            share('density_{}'.format(i), (nverts,), np.float32)
+            dparams.append(dp)
+
+        params = {'bbox': bbox, 'periodic': periodic, 'tiles': tiles, 'bb0': bb0, 'boxw': boxw,
+                  'cutoff': float(cutoff),
+                  'normals': normals, 'curvature': curvature, 'densities': dparams}
+
+        # ----------------------------------------------------------------------
+        # spawn (not fork) the workers, to not inherit OpenMP state
+        nprocs = ntiles if nprocs is None else max(1, min(int(nprocs), ntiles))
+        ctx = mp.get_context('spawn')
+        with ctx.Pool(processes=nprocs) as pool:
+            for (t, nowned) in pool.imap_unordered(_tile_worker,
+                                                   [(t, desc, params) for t in range(ntiles)]):
+                LOGGER.debug('\ttile {} owns {} vertices'.format(t, nowned))
+
+        # ----------------------------------------------------------------------
+        # gather (and normalize the counts of the densities globally)
+        def read(key):
+            return np.ndarray(desc[key]['shape'], dtype=np.dtype(desc[key]['dtype']),
+                              buffer=shms[key].buf).copy()
+
+        results = {}
+        if normals:
+            results['normals'] = read('normals')
+            results['pareas'] = read('pareas')
+        if curvature:
+            results['mean_curv'] = read('mean_curv')
+            results['gaus_curv'] = read('gaus_curv')
+
+        for i, d in enumerate(densities):
+
+            # as TriMesh::kde: sequential sum, and scale, in single precision
+            dens = read('density_{}'.format(i))
+            if d.get('get_nlipids', False):
+                np_ = len(d['pidxs']) if len(d.get('pidxs', [])) > 0 else nverts
+                dsm = np.cumsum(dens, dtype=np.float32)[-1]
+                dens = dens * (np.float32(np_) / dsm)
+            results[d['name']] = dens
+
+    finally:
+        for shm in shms.values():
+            shm.close()
+            shm.unlink()
+
+    mtimer.end()
+    LOGGER.info('Computed properties on {} tiles! took {}'.format(ntiles, mtimer))
+    return results
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
@@ -0,0 +1,130 @@
+'''
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+'''
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+
+import numpy as np
+import logging
+LOGGER = logging.getLogger(__name__)
+
+from . import pymemsurfer
+from .utils import Timer
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
+class LateralDiffusion(object):
+    '''
+       Class to compute the lateral mean squared displacement of the lipids of
+       a leaflet (in the planar parameterization) over many frames
+    '''
+
+    # --------------------------------------------------------------------------
+    # constructor
+    def __init__(self, labels, dt=1., **kwargs):
+        '''
+        labels: ndarray of shape (nlipids,): species of every lipid
+                    a lipid is identified by its index in labels
+        dt:     time between consecutive frames (the unit of the lag times)
+        kwargs:
+                label:  label for this object
+        '''
+        labels = np.asarray(labels)
+        if len(labels.shape) != 1 or labels.shape[0] == 0:
+            raise ValueError('LateralDiffusion needs one label per lipid')
+
+        self.species, sids = np.unique(labels, return_inverse=True)
+        self.nlipids = labels.shape[0]
+        self.dt = float(dt)
+        self.label = kwargs.get('label', 'LateralDiffusion')
+        self.cverbose = LOGGER.isEnabledFor(logging.DEBUG)
+
+        self.ld = pymemsurfer.LateralDiffusion(sids.astype(np.int32))
+
+        LOGGER.info('{} Created for {} lipids of {} species: {}'
+                    .format(self.tag(), self.nlipids, len(self.species), list(self.species)))
+
+    # --------------------------------------------------------------------------
+    def tag(self):
+        return '[{}]'.format(self.label)
+
+    def nframes(self):
+        return self.ld.nframes()
+
+    # --------------------------------------------------------------------------
+    def add_frame(self, positions, boxw=None):
+        '''
+            Add the positions of all lipids for one frame
+                positions: ndarray (nlipids, 2/3)
+                boxw:      width of the periodic box in xy (None for no unwrapping)
+        '''
+        positions = np.ascontiguousarray(positions, dtype=np.float32)
+        if positions.shape[0] != self.nlipids:
+            raise ValueError('Got {} positions for {} lipids'.format(positions.shape[0], self.nlipids))
+
+        bx, by = (0., 0.) if boxw is None else (float(boxw[0]), float(boxw[1]))
+        self.ld.add_frame(positions, bx, by, self.cverbose)
+
+    def add_membrane(self, m):
+        '''
+            Add the parameterized positions (ppoints) of one frame of a membrane
+                (point i is lipid i)
+            the positions are unwrapped with the period of the parameterization
+                used to triangulate them (m.pperiod)
+            must be called after the membrane surface is computed, and before
+                m.write() or m.release(), which delete ppoints with retain='minimal'
+        '''
+        if not hasattr(m, 'ppoints'):
+            raise ValueError('{} add_membrane() needs the parameterized points of the membrane: '
+                             'call it before write()/release() with retain=\'minimal\''.format(self.tag()))
+
+        boxw = m.pperiod if m.periodic else None
+        self.add_frame(m.ppoints, boxw)
+
+    # --------------------------------------------------------------------------
+    def msd(self, species=None, remove_drift=True):
+        '''
+            Mean squared displacement of the lipids of a species (None for all)
+                returns (lag times, msd)
+        '''
+        sid = -1
+        if species is not None:
+            idx = np.where(self.species == species)[0]
+            if len(idx) == 0:
+                raise ValueError('Unknown species ({}). Should be one of {}'.format(species, list(self.species)))
+            sid = int(idx[0])
+
+        mtimer = Timer()
+        msd = np.array(self.ld.msd(sid, remove_drift, self.cverbose), dtype=np.float32)
+        mtimer.end()
+        LOGGER.info('{} Computed msd of {} for {} frames! took {}'
+                    .format(self.tag(), 'all' if species is None else species, self.nframes(), mtimer))
+
+        return self.dt * np.arange(msd.shape[0]), msd
+
+    def msd_species(self, remove_drift=True):
+        '''
+            Mean squared displacement of all lipids and of every species
+                returns {species: (lag times, msd)}, with 'all' for all lipids
+        '''
+        result = {'all': self.msd(None, remove_drift)}
+        for s in self.species:
+            result[s] = self.msd(s, remove_drift)
+        return result
+
+    def trajectory(self, lipid, remove_drift=False):
+        '''
+            The unwrapped trajectory of a lipid: ndarray (nframes, 2)
+        '''
+        return np.array(self.ld.trajectory(int(lipid), remove_drift)).reshape(-1, 2)
+
+# ------------------------------------------------------------------------------
+# ------------------------------------------------------------------------------
@@ -0,0 +1,226 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _CELLLIST_H_
+#define _CELLLIST_H_
+
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "Types.hpp"
+#include "DistanceKernels.hpp"
+
+//! ----------------------------------------------------------------------------
+//!
+//! \brief This file provides a (periodic) cell list for neighborhood queries
+//!
+//!     points are binned in a regular grid over their bounding box (in the
+//!     first dim coordinates). along the periodic dimensions of the distance
+//!     kernel, the grid spans one period and the cells wrap around.
+//!     distances are always measured with the distance kernel (square distance)
+//!
+//! ----------------------------------------------------------------------------
+
+class CellList {
+
+public:
+    //! build a cell list on the given points (or the subset given by ids)
+    //!     cellsize is a hint; the grid is coarsened to keep at most ~4 cells per point
+    CellList(const std::vector<Vertex> &points, const std::vector<TypeIndexI> &ids,
+             const DistanceKernel &dist, const uint8_t dim, TypeFunction cellsize) :
+        mPoints(points), mDist(dist), mDim(dim) {
+
+        std::vector<TypeIndex> idx;
+        if (ids.empty()) {
+            idx.resize(points.size());
+            for(TypeIndex i = 0; i < idx.size(); i++)
+                idx[i] = i;
+        }
+        else {
+            idx.assign(ids.begin(), ids.end());
+        }
+
+        mOrigin = Vertex(0,0,0);
+        Vertex vmax (0,0,0);
+        if (!idx.empty()) {
+            mOrigin = vmax = points[idx[0]];
+            for(TypeIndex i = 1; i < idx.size(); i++) {
+                mOrigin.min(points[idx[i]]);
+                vmax.max(points[idx[i]]);
+            }
+        }
+
+        // the extent (or period) of the grid along each dimension
+        Vertex extent (0,0,0);
+        for(uint8_t d = 0; d < mDim; d++) {
+            mPeriodic[d] = (dist.period(d) > 0);
+            extent[d] = mPeriodic[d] ? dist.period(d) : std::max(TypeFunction(1e-6), vmax[d] - mOrigin[d]);
+        }
+
+        cellsize = std::max(cellsize, TypeFunction(1e-6));
+        const size_t maxcells = std::max(size_t(1), 4*idx.size());
+        while (true) {
+            size_t ncells = 1;
+            for(uint8_t d = 0; d < mDim; d++) {
+                mNCells[d] = std::max(1, int(std::floor(extent[d] / cellsize)));
+                ncells *= mNCells[d];
+            }
+            if (ncells <= maxcells)
+                break;
+            cellsize *= 1.5;
+        }
+        for(uint8_t d = 0; d < 3; d++) {
+            if (d >= mDim) {    mNCells[d] = 1;     mCellSize[d] = 1;   }
+            else {              mCellSize[d] = extent[d] / TypeFunction(mNCells[d]);  }
+        }
+
+        // counting sort of the points into the cells
+        const size_t ncells = size_t(mNCells[0])*mNCells[1]*mNCells[2];
+        mCellStart.assign(ncells+1, 0);
+
+        std::vector<TypeIndex> pcell (idx.size());
+        for(TypeIndex i = 0; i < idx.size(); i++) {
+            pcell[i] = cell_of(points[idx[i]]);
+            mCellStart[pcell[i]+1]++;
+        }
+        for(size_t c = 0; c < ncells; c++)
+            mCellStart[c+1] += mCellStart[c];
+
+        std::vector<TypeIndex> fill (mCellStart.begin(), mCellStart.end()-1);
+        mCellPoints.resize(idx.size());
+        for(TypeIndex i = 0; i < idx.size(); i++) {
+            mCellPoints[fill[pcell[i]]++] = idx[i];
+        }
+    }
+
+    size_t size() const {   return mCellPoints.size();  }
+
+    //! all points within (euclidean) radius r of q, as (index, square distance)
+    void radius(const Vertex &q, const TypeFunction r,
+                std::vector<std::pair<TypeIndex, TypeFunction>> &nbrs) const {
+
+        nbrs.clear();
+
+        int lo[3] = {0,0,0}, hi[3] = {0,0,0};
+        for(uint8_t d = 0; d < mDim; d++) {
+
+            const TypeFunction a = (q[d] - mOrigin[d] - r) / mCellSize[d];
+            const TypeFunction b = (q[d] - mOrigin[d] + r) / mCellSize[d];
+
+            // guard against overflow for very large radii
+            lo[d] = (a < -mNCells[d]) ? -mNCells[d] : int(std::floor(a));
+            hi[d] = (b > 2*mNCells[d]) ? 2*mNCells[d] : int(std::floor(b));
+
+            if (mPeriodic[d]) {
+                if (hi[d]-lo[d]+1 >= mNCells[d]) {  lo[d] = 0;    hi[d] = mNCells[d]-1;   }
+            }
+            else {
+                lo[d] = std::max(lo[d], 0);
+                hi[d] = std::min(hi[d], mNCells[d]-1);
+            }
+        }
+
+        const TypeFunction r2 = r*r;
+        for(int i = lo[0]; i <= hi[0]; i++) {
+        for(int j = lo[1]; j <= hi[1]; j++) {
+        for(int k = lo[2]; k <= hi[2]; k++) {
+
+            const size_t c = cell_index(wrap(i,0), wrap(j,1), wrap(k,2));
+            for(TypeIndex p = mCellStart[c]; p < mCellStart[c+1]; p++) {
+
+                const TypeIndex pidx = mCellPoints[p];
+                const TypeFunction d2 = distance(q, mPoints[pidx]);
+                if (d2 <= r2)
+                    nbrs.push_back(std::make_pair(pidx, d2));
+            }
+        }}}
+    }
+
+    //! (euclidean) distance from the point with index qidx to its k-th nearest neighbor
+    //!     (the point itself is excluded)
+    TypeFunction knn_distance(const TypeIndex qidx, const TypeIndex k, TypeFunction r0) const {
+
+        const TypeIndex nothers = mCellPoints.size() - 1;
+        if (k == 0 || nothers == 0)
+            return 0;
+
+        const TypeIndex kk = std::min(k, nothers);
+
+        std::vector<std::pair<TypeIndex, TypeFunction>> nbrs;
+        std::vector<TypeFunction> d2s;
+
+        TypeFunction r = std::max(r0, TypeFunction(1e-6));
+        while (true) {
+
+            this->radius(mPoints[qidx], r, nbrs);
+
+            d2s.clear();
+            for(auto iter = nbrs.begin(); iter != nbrs.end(); iter++) {
+                if (iter->first != qidx)
+                    d2s.push_back(iter->second);
+            }
+
+            // all points within r are found, so the k-th one is exact
+            if (d2s.size() >= kk) {
+                std::nth_element(d2s.begin(), d2s.begin()+kk-1, d2s.end());
+                return std::sqrt(d2s[kk-1]);
+            }
+            r *= 2;
+        }
+    }
+
+private:
+    const std::vector<Vertex> &mPoints;
+    const DistanceKernel &mDist;
+    const uint8_t mDim;
+
+    Vertex mOrigin, mCellSize;
+    int mNCells[3];
+    bool mPeriodic[3] = {false, false, false};
+
+    std::vector<TypeIndex> mCellStart;      // ncells+1 offsets into mCellPoints
+    std::vector<TypeIndex> mCellPoints;
+
+    TypeFunction distance(const Vertex &a, const Vertex &b) const {
+        return (mDim == 2) ? mDist(a[0], a[1], b[0], b[1]) :
+                             mDist(a[0], a[1], a[2], b[0], b[1], b[2]);
+    }
+
+    int wrap(int i, const uint8_t d) const {
+        if (!mPeriodic[d])
+            return i;
+        i %= mNCells[d];
+        return (i < 0) ? i + mNCells[d] : i;
+    }
+
+    size_t cell_index(const int i, const int j, const int k) const {
+        return (size_t(k)*mNCells[1] + j)*mNCells[0] + i;
+    }
+
+    TypeIndex cell_of(const Vertex &p) const {
+        int c[3] = {0,0,0};
+        for(uint8_t d = 0; d < mDim; d++) {
+            c[d] = int(std::floor((p[d] - mOrigin[d]) / mCellSize[d]));
+            c[d] = mPeriodic[d] ? wrap(c[d], d) : std::min(std::max(c[d], 0), mNCells[d]-1);
+        }
+        return cell_index(c[0], c[1], c[2]);
+    }
+};
+
+//! ----------------------------------------------------------------------------
+//! ----------------------------------------------------------------------------
+
+#endif /* _CELLLIST_H_ */
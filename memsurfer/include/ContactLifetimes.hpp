@@ -0,0 +1,106 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _CONTACT_LIFETIMES_H_
+#define _CONTACT_LIFETIMES_H_
+
+#include <string>
+#include <vector>
+
+#include "Types.hpp"
+
+class TriMesh;
+
+/// ---------------------------------------------------------------------------------------
+//!
+//! \brief This class accumulates the lifetimes of lipid-lipid contacts over many frames
+//!
+//!     the contacts of a frame are the edges of its planar (Delaunay) mesh, including
+//!     the periodic faces. every frame, the (sorted) edge keys are diffed against the
+//!     contacts of the previous frame in a single merge: contacts that disappeared are
+//!     added to the lifetime histogram of their species pair, and new contacts start.
+//!     only the contacts of the previous frame are stored, so the memory does not grow
+//!     with the number of frames.
+//!
+//!     lipids are identified by global ids (0 to nlipids-1), each with a species. by
+//!     default, vertex i of every frame is lipid i; otherwise (e.g., with flip-flop)
+//!     the ids of the vertices are given with every frame.
+//!
+//!     lifetimes are in frames: bin k counts the contacts that lasted k+1 frames, and
+//!     the last bin also those that lasted longer. contacts present in the first frame
+//!     have an unknown start, and are counted separately (as censored) when they end.
+//!
+/// ---------------------------------------------------------------------------------------
+class ContactLifetimes {
+
+    uint32_t mNSpecies, mNBins;
+    std::vector<TypeIndex> mSpecies;        //!< species of every lipid
+
+    uint64_t mNFrames;
+
+    //! contacts of the previous frame (sorted keys) and the frame each began in
+    std::vector<uint64_t> mKeys;
+    std::vector<uint32_t> mStart;
+
+    //! per species pair
+    std::vector<uint64_t> mHistogram;       //!< npairs x nbins
+    std::vector<uint64_t> mCensored;
+    std::vector<uint64_t> mFormed, mBroken;
+
+    //! the (sorted, unique) contacts of a frame
+    void contacts(const TriMesh &planar, const int *ids, std::vector<uint64_t> &keys) const;
+
+    uint32_t pair(const uint64_t key) const;
+
+public:
+
+    //! species of every lipid (0 to nspecies-1), and number of lifetime bins
+    ContactLifetimes(int *_, int n, int nbins);
+    ~ContactLifetimes() {}
+
+    std::string tag() const {   return "ContactLifetimes";  }
+
+    uint32_t nlipids() const {  return mSpecies.size();     }
+    uint32_t nspecies() const { return mNSpecies;           }
+    uint32_t nbins() const {    return mNBins;              }
+    uint32_t npairs() const {   return mNSpecies*(mNSpecies+1)/2;   }
+    uint64_t nframes() const {  return mNFrames;            }
+
+    //! number of contacts in the last frame
+    size_t ncontacts() const {  return mKeys.size();        }
+
+    //! index of the (unordered) species pair
+    uint32_t pair_index(int a, int b) const;
+
+    //! -----------------------------------------------------------------------------------
+    //! add the contacts of one frame
+    //!     ids: global lipid id of every vertex of planar (n = 0 for the identity)
+    void add_frame(const TriMesh &planar, int *_, int n, bool verbose = false);
+
+    //! -----------------------------------------------------------------------------------
+    //! per species pair statistics
+    std::vector<TypeIndexI> histogram(int a, int b) const;
+    uint64_t censored(int a, int b) const { return mCensored[pair_index(a,b)];  }
+    uint64_t formed(int a, int b) const {   return mFormed[pair_index(a,b)];    }
+    uint64_t broken(int a, int b) const {   return mBroken[pair_index(a,b)];    }
+
+    //! ages (in frames) of the contacts of a species pair that have not ended yet
+    std::vector<TypeIndexI> active(int a, int b) const;
+
+    void clear();
+};
+
+/// ---------------------------------------------------------------------------------------
+
+#endif /* _CONTACT_LIFETIMES_H_ */
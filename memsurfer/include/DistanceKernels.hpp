@@ -17,6 +17,7 @@ For details, see https://github.com/LLNL/MemSurfer.
 
 #include <cmath>
 #include <vector>
+#include <algorithm>
 
 #include "Types.hpp"
 
@@ -41,6 +42,34 @@ public:
                (dim == 3) ? this->operator ()(a[0], a[1], a[2], b[0], b[1], b[2]) : -1;
     }
 
+    //! period of the domain along dimension d (0 = not periodic)
+    virtual TypeFunction period(const uint8_t) const {     return 0;   }
+
+    //! bounds on the (square) distance between any two points of two axis-aligned boxes
+    //! [amin, amax] and [bmin, bmax] (both inside the domain, if periodic)
+    void box_bounds(const Vertex &amin, const Vertex &amax, const Vertex &bmin, const Vertex &bmax,
+                    const uint8_t &dim, TypeFunction &dmin2, TypeFunction &dmax2) const {
+
+        dmin2 = 0;
+        dmax2 = 0;
+        for (uint8_t d = 0; d < dim; d++) {
+
+            const TypeFunction w = this->period(d);
+
+            TypeFunction near = std::max(TypeFunction(0), std::max(amin[d] - bmax[d], bmin[d] - amax[d]));
+            TypeFunction far = std::max(amax[d] - bmin[d], bmax[d] - amin[d]);
+
+            // the nearest periodic images of b are shifted by +/- w
+            if (w > 0) {
+                near = std::min(near, std::max(TypeFunction(0), std::max(amin[d] - bmax[d] - w, bmin[d] + w - amax[d])));
+                near = std::min(near, std::max(TypeFunction(0), std::max(amin[d] - bmax[d] + w, bmin[d] - w - amax[d])));
+                far = std::min(far, TypeFunction(0.5)*w);
+            }
+            dmin2 += near*near;
+            dmax2 += far*far;
+        }
+    }
+
     //! ------------------------------------------------------------------------
 protected:
     static bool parse_bbox(float *_, int n, Vertex &bbox0, Vertex &bbox1) {
@@ -117,6 +146,10 @@ public:
                 << " [" << mBoxw[0] << ", " << mBoxw[1] << ", " << mBoxw[2] << "]\n";
     }
 
+    TypeFunction period(const uint8_t d) const {
+        return (d < 2) ? mBoxw[d] : 0;
+    }
+
     TypeFunction operator()(TypeFunction ax, TypeFunction ay, TypeFunction bx, TypeFunction by) const {
 
         if (fabs(ax - bx) >= 0.5*mBoxw[0]) {
@@ -154,6 +187,10 @@ public:
       }
       this->mBoxw = mBox1 - mBox0;
     }
+    TypeFunction period(const uint8_t d) const {
+        return (d < 3) ? mBoxw[d] : 0;
+    }
+
     TypeFunction operator()(TypeFunction ax, TypeFunction ay, TypeFunction bx, TypeFunction by) const {
 
         if (fabs(ax - bx) >= 0.5*mBoxw[0]) {
@@ -0,0 +1,112 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _FIELD_ACCUMULATOR_H_
+#define _FIELD_ACCUMULATOR_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "Types.hpp"
+
+class TriMesh;
+
+/// ---------------------------------------------------------------------------------------
+//!
+//! \brief This class accumulates fields over many frames on a fixed reference grid
+//!
+//!     the grid (nx x ny samples at cell centers) is defined in the parameterized plane.
+//!     every frame, the fields of a mesh are interpolated (linearly, over the triangles
+//!     of the planar mesh) at the grid samples, and added to running (Welford) estimates
+//!     of the mean and variance of each sample. only the running estimates are stored,
+//!     so the memory does not grow with the number of frames.
+//!
+//!     for periodic planar meshes (with a bounding box), the box of every frame is
+//!     mapped onto the box of the grid (i.e., samples are at fixed fractional coordinates)
+//!
+/// ---------------------------------------------------------------------------------------
+class FieldAccumulator {
+
+    //! running statistics of one field
+    struct Stats {
+        uint64_t nframes;
+        std::vector<uint32_t> count;
+        std::vector<double> mean;
+        std::vector<double> m2;
+    };
+
+    //! reference grid
+    Vertex mBox0, mBox1;
+    uint32_t mNx, mNy;
+
+    std::unordered_map<std::string, Stats> mStats;
+
+    //! a grid sample located in a triangle (vertex ids and barycentric coordinates)
+    struct Sample {
+        TypeIndex v[3];
+        TypeFunction w[3];
+    };
+
+    //! locate the grid samples in the triangles of the planar mesh
+    void rasterize(const TriMesh &planar, std::vector<Sample> &samples, std::vector<bool> &valid) const;
+
+    //! add one sampled frame
+    void add(Stats &stats, const std::vector<TypeFunction> &values, const std::vector<bool> &valid);
+
+    const Stats& stats(const std::string &name) const;
+
+public:
+
+    //! bbox = [x0, y0, x1, y1] of the reference grid
+    FieldAccumulator(float *_, int n, int nx, int ny);
+    ~FieldAccumulator() {}
+
+    std::string tag() const {   return "FieldAccumulator";  }
+
+    uint32_t nx() const {       return mNx;     }
+    uint32_t ny() const {       return mNy;     }
+
+    //! -----------------------------------------------------------------------------------
+    //! accumulate the named fields of mesh (defined on its vertices) for one frame
+    //!     planar is the parameterization of mesh (same vertices)
+    void accumulate(const TriMesh &planar, const TriMesh &mesh,
+                    const std::vector<std::string> &names, bool verbose = false);
+
+    //! accumulate a field given directly on the grid (nx*ny values, nan = missing)
+    void accumulate_grid(const std::string &name, float *_, int n);
+
+    //! -----------------------------------------------------------------------------------
+    //! the names of the accumulated fields
+    std::vector<std::string> names() const;
+
+    //! number of frames accumulated for a field
+    uint64_t nframes(const std::string &name) const {   return stats(name).nframes;     }
+
+    //! per sample statistics (row major, ny x nx); nan where no frame had a sample
+    std::vector<TypeFunction> mean(const std::string &name) const;
+    std::vector<TypeFunction> variance(const std::string &name) const;
+    std::vector<TypeIndexI> count(const std::string &name) const;
+
+    //! -----------------------------------------------------------------------------------
+    //! checkpointing
+    bool save(const std::string &filename, bool verbose = false) const;
+    bool load(const std::string &filename, bool verbose = false);
+
+    void clear() {  mStats.clear();     }
+};
+
+/// ---------------------------------------------------------------------------------------
+
+#endif /* _FIELD_ACCUMULATOR_H_ */
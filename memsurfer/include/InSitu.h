@@ -0,0 +1,118 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _MEMSURFER_INSITU_H_
+#define _MEMSURFER_INSITU_H_
+
+/// ---------------------------------------------------------------------------------------
+//!
+//! \brief C API to run MemSurfer in situ (e.g., inside an MD engine)
+//!
+//!     the host creates a persistent context for one leaflet (the selected beads),
+//!     and pushes the coordinates of all atoms every N steps. ms_push() gathers the
+//!     selected beads before returning, so the host can continue its step right away;
+//!     the analysis runs asynchronously on worker threads:
+//!         the xy-positions are triangulated (periodic Delaunay), the surface is
+//!         smoothed (Taubin), and per-lipid properties are computed
+//!
+//!     per-lipid results (one row of ms_nvalues() values per selected bead):
+//!         area, mean curvature, Gaussian curvature, normal (x, y, z),
+//!         followed by one column per density added with ms_add_density()
+//!
+//!     all functions return 0 on success and -1 on error (see ms_last_error)
+//!     a context must be used from one host thread only
+//!
+/// ---------------------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ms_context ms_context;
+
+//! columns of the per-lipid results
+enum {
+    MS_AREA = 0,
+    MS_CURV_MEAN,
+    MS_CURV_GAUSS,
+    MS_NORMAL_X,
+    MS_NORMAL_Y,
+    MS_NORMAL_Z,
+    MS_DENSITY              //!< first density column
+};
+
+//! -----------------------------------------------------------------------------------
+//! create a context
+//!     periodic:   whether the box is periodic in xy
+//!     box:        box lengths (x, y, z) with origin at 0 (may be NULL if not periodic)
+//!     natoms:     number of atoms in the coordinate arrays pushed by the host
+//!     nselected:  number of selected beads (one per lipid)
+//!     selected:   indices of the selected beads in the coordinate arrays
+//!     labels:     labels of the selected beads (may be NULL)
+//!     nworkers:   number of frames analyzed concurrently
+//!     nthreads:   number of (OpenMP) threads used per frame
+//!     returns NULL on invalid input
+ms_context* ms_create(int periodic, const float *box, int natoms,
+                      int nselected, const int *selected, const int *labels,
+                      int nworkers, int nthreads);
+
+//! wait for all pending frames and release the context
+//!     (including the results that were not retrieved with ms_get_results)
+void ms_destroy(ms_context *ctx);
+
+//! the last error reported for this context (empty if none)
+const char* ms_last_error(const ms_context *ctx);
+
+//! -----------------------------------------------------------------------------------
+//! configuration (only before the first ms_push)
+
+//! add a (2D Gaussian) density of the lipids with a given label (label < 0: all lipids)
+//!     returns the column of this density in the results, or -1 on error
+int ms_add_density(ms_context *ctx, float sigma, int label);
+
+//! Taubin smoothing of the surface (niters = 0 uses the exact surface; default 10)
+int ms_set_smoothing(ms_context *ctx, int niters, float lambda, float mu);
+
+//! write the surface of every frame to <prefix>_<step>.vtp (NULL or "" disables)
+int ms_set_output(ms_context *ctx, const char *prefix);
+
+//! number of values per lipid in the results
+int ms_nvalues(const ms_context *ctx);
+
+//! NUMA placement of the large arrays (see Numa.hpp): first touch by the OpenMP
+//!     threads, and transparent huge pages (both off by default)
+//!     these settings are process-wide; the threads may be pinned with OMP_PROC_BIND/OMP_PLACES
+void ms_set_numa(int first_touch, int huge_pages);
+
+//! -----------------------------------------------------------------------------------
+//! analysis
+
+//! queue a frame: coords = natoms x 3 (xyz), box = current box lengths (may be NULL)
+//!     blocks only if too many frames are pending (2 per worker)
+int ms_push(ms_context *ctx, long step, const float *coords, const float *box);
+
+//! wait for a frame (step < 0: wait for all pushed frames)
+int ms_wait(ms_context *ctx, long step);
+
+//! copy the results of a finished frame into out (nselected x ms_nvalues() values)
+//!     and release them; returns -1 if the frame failed, is unknown, or is not done yet
+//!     nout = length of out in floats (at least nselected * ms_nvalues())
+int ms_get_results(ms_context *ctx, long step, float *out, int nout);
+
+#ifdef __cplusplus
+}
+#endif
+
+/// ---------------------------------------------------------------------------------------
+#endif  /* _MEMSURFER_INSITU_H_ */
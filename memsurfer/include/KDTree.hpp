@@ -0,0 +1,120 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _KDTREE_H_
+#define _KDTREE_H_
+
+#include <vector>
+#include <algorithm>
+
+#include "Types.hpp"
+
+//! ----------------------------------------------------------------------------
+//!
+//! \brief This file provides a simple (static) k-d tree over a set of vertices
+//!
+//!     the tree does not store the points, but a permutation of their indices
+//!     such that every node owns a contiguous range [begin, end) of it.
+//!     nodes are split at the median of their widest dimension until they
+//!     contain at most leafsize points
+//!
+//! ----------------------------------------------------------------------------
+
+class KDTree {
+
+public:
+    struct Node {
+        Vertex bmin, bmax;          // bounding box of the points in the node
+        TypeIndex begin, end;       // range in mIndex
+        TypeIndexI left, right;     // children (-1 for leaves)
+
+        bool is_leaf() const {      return left < 0;        }
+        TypeIndex size() const {    return end - begin;     }
+    };
+
+    std::vector<Node> mNodes;       // mNodes[0] is the root
+    std::vector<TypeIndex> mIndex;  // permuted indices of the points
+
+    //! build the tree on the first dim coordinates of the given points
+    //!     (or the subset given by ids, if not empty)
+    KDTree(const std::vector<Vertex> &points, const std::vector<TypeIndexI> &ids,
+           const uint8_t dim, const TypeIndex leafsize = 32) :
+        mPoints(points), mDim(dim), mLeafSize(std::max(TypeIndex(1), leafsize)) {
+
+        if (ids.empty()) {
+            mIndex.resize(points.size());
+            for(TypeIndex i = 0; i < mIndex.size(); i++)
+                mIndex[i] = i;
+        }
+        else {
+            mIndex.assign(ids.begin(), ids.end());
+        }
+
+        if (mIndex.empty())
+            return;
+
+        mNodes.reserve(2*(mIndex.size()/mLeafSize + 1));
+        build(0, mIndex.size());
+    }
+
+private:
+    const std::vector<Vertex> &mPoints;
+    const uint8_t mDim;
+    const TypeIndex mLeafSize;
+
+    TypeIndexI build(const TypeIndex begin, const TypeIndex end) {
+
+        const TypeIndexI nidx = mNodes.size();
+        mNodes.push_back(Node());
+
+        Node node;
+        node.begin = begin;
+        node.end = end;
+        node.left = node.right = -1;
+
+        node.bmin = node.bmax = mPoints[mIndex[begin]];
+        for(TypeIndex i = begin+1; i < end; i++) {
+            node.bmin.min(mPoints[mIndex[i]]);
+            node.bmax.max(mPoints[mIndex[i]]);
+        }
+
+        if (end - begin > mLeafSize) {
+
+            // split at the median of the widest dimension
+            uint8_t sdim = 0;
+            for(uint8_t d = 1; d < mDim; d++) {
+                if (node.bmax[d]-node.bmin[d] > node.bmax[sdim]-node.bmin[sdim])
+                    sdim = d;
+            }
+
+            const TypeIndex mid = begin + (end - begin)/2;
+            const std::vector<Vertex> &pts = mPoints;
+            std::nth_element(mIndex.begin()+begin, mIndex.begin()+mid, mIndex.begin()+end,
+                             [&pts, sdim](const TypeIndex a, const TypeIndex b) {
+                                return pts[a][sdim] < pts[b][sdim];
+                             });
+
+            node.left = build(begin, mid);
+            node.right = build(mid, end);
+        }
+
+        mNodes[nidx] = node;
+        return nidx;
+    }
+};
+
+//! ----------------------------------------------------------------------------
+//! ----------------------------------------------------------------------------
+
+#endif /* _KDTREE_H_ */
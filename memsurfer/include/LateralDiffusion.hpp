@@ -0,0 +1,84 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _LATERAL_DIFFUSION_H_
+#define _LATERAL_DIFFUSION_H_
+
+#include <string>
+#include <vector>
+
+#include "Types.hpp"
+
+/// ---------------------------------------------------------------------------------------
+//!
+//! \brief This class computes the lateral mean squared displacement (MSD) of lipids
+//!
+//!     every frame, the (planar parameterized) positions of all lipids are unwrapped
+//!     across the periodic boundaries (using the minimum image displacement from the
+//!     previous frame), and appended to the trajectories; the mean position of all
+//!     lipids (i.e., the center of mass drift of the leaflet) is kept for every frame.
+//!
+//!     the msd for all lag times is computed with the fft-based algorithm, i.e.,
+//!     msd(m) = S1(m) - 2 S2(m), where S2 is the autocorrelation of the positions,
+//!     in O(T log T) per lipid (instead of O(T^2)), in parallel over lipids.
+//!
+//!     only the unwrapped displacements are stored (2 floats per lipid per frame).
+//!
+/// ---------------------------------------------------------------------------------------
+class LateralDiffusion {
+
+    uint32_t mNSpecies;
+    std::vector<TypeIndex> mSpecies;        //!< species of every lipid
+
+    uint32_t mNFrames;
+
+    //! the first and the last (wrapped) positions, and the unwrapped
+    //! displacements from the first positions (frame major)
+    std::vector<double> mFirst, mLast;
+    std::vector<float> mTrajectory;         //!< nframes x nlipids x 2
+
+    //! mean displacement of all lipids in every frame
+    std::vector<double> mDrift;             //!< nframes x 2
+
+public:
+
+    //! species of every lipid (0 to nspecies-1)
+    LateralDiffusion(int *_, int n);
+    ~LateralDiffusion() {}
+
+    std::string tag() const {   return "LateralDiffusion";  }
+
+    uint32_t nlipids() const {  return mSpecies.size();     }
+    uint32_t nspecies() const { return mNSpecies;           }
+    uint32_t nframes() const {  return mNFrames;            }
+
+    //! -----------------------------------------------------------------------------------
+    //! add the positions (nlipids x 2/3; only xy is used) of all lipids for one frame
+    //!     bx, by: width of the periodic box (0 for no unwrapping)
+    void add_frame(float *_, int n, int d, float bx, float by, bool verbose = false);
+
+    //! -----------------------------------------------------------------------------------
+    //! msd of the lipids of a species (-1 for all) for lag times 0 to nframes-1 (in frames)
+    //!     optionally, with the center of mass drift of the leaflet removed
+    std::vector<TypeFunction> msd(int species = -1, bool remove_drift = true, bool verbose = false) const;
+
+    //! the unwrapped trajectory of a lipid (nframes x 2)
+    std::vector<TypeFunction> trajectory(int lipid, bool remove_drift = false) const;
+
+    void clear();
+};
+
+/// ---------------------------------------------------------------------------------------
+
+#endif /* _LATERAL_DIFFUSION_H_ */
@@ -0,0 +1,90 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _MESH_TASKS_H_
+#define _MESH_TASKS_H_
+
+#include <string>
+#include <vector>
+
+#include "Types.hpp"
+
+class TriMesh;
+
+/// ---------------------------------------------------------------------------------------
+//!
+//! \brief Concurrent computation of the properties of one or more meshes
+//!
+//!     properties (normals, point areas, curvatures, densities) are queued for any
+//!     number of meshes (e.g., the exact and smooth surfaces of both leaflets), and
+//!     computed by run() as a task graph (see TaskGraph.hpp): every task declares the
+//!     cached properties it writes, so independent ones run concurrently, while the
+//!     OpenMP loops inside each of them share the threads.
+//!
+//!     the results are the same as computing them one after another: they are cached
+//!     in the meshes (as by need_normals(), kde(), etc.), which then return them
+//!     without recomputing. the meshes must outlive run(), and must not be used
+//!     elsewhere while it runs.
+//!
+/// ---------------------------------------------------------------------------------------
+class MeshTasks {
+
+    enum TaskType { NORMALS, POINTAREAS, CURVATURE, DENSITY };
+
+    struct Request {
+        TaskType type;
+        TriMesh *mesh;
+
+        // density parameters
+        std::string name;
+        int ktype;
+        TypeFunction sigma;
+        bool get_counts;
+        std::vector<TypeIndexI> ids;
+        TypeFunction tolerance;
+        int knn;
+        bool fast_exp;
+    };
+
+    std::vector<Request> mRequests;
+
+    void add(const TaskType type, TriMesh &mesh);
+
+public:
+
+    MeshTasks() {}
+    ~MeshTasks() {}
+
+    std::string tag() const {   return "MeshTasks";     }
+    size_t size() const {       return mRequests.size();    }
+    void clear() {              mRequests.clear();      }
+
+    //! queue the properties of a mesh
+    void add_normals(TriMesh &mesh) {       add(NORMALS, mesh);     }
+    void add_pointareas(TriMesh &mesh) {    add(POINTAREAS, mesh);  }
+    void add_curvature(TriMesh &mesh) {     add(CURVATURE, mesh);   }
+
+    //! queue a density (see TriMesh::kde): Gaussian kernel of the given sigma
+    //!     (2D for types 1, 2, and 5, 3D for type 3, unused for type 4), and the
+    //!     periodic (xy) or euclidean distance of the mesh
+    void add_density(TriMesh &mesh, const std::string &name, const int type, const float sigma,
+                     const bool get_counts, const std::vector<TypeIndexI> &ids,
+                     const float tolerance = 0, const int knn = 0, const bool fast_exp = false);
+
+    //! compute all queued properties on nthreads threads (0 = all), and clear the queue
+    void run(int nthreads = 0, bool verbose = false);
+};
+
+/// ---------------------------------------------------------------------------------------
+#endif  /* _MESH_TASKS_H_ */
@@ -0,0 +1,119 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _NUMA_H_
+#define _NUMA_H_
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+
+/// ---------------------------------------------------------------------------------------
+//!
+//! \brief NUMA-aware placement of large arrays and OpenMP threads (Linux only)
+//!
+//!     these settings are for the standalone (in-situ) library, which is built with
+//!     OpenMP (see ms_set_numa() in InSitu.h); the python module is built without it.
+//!
+//!     first touch (off by default):
+//!         large arrays (vertices, faces, normals, densities, geodesics) are written
+//!         for the first time by the OpenMP threads, in contiguous blocks (static
+//!         schedule), so that their pages are placed on the memory nodes of those
+//!         threads. std::vector zero-fills its memory on one thread, so the (whole)
+//!         pages of the array are first released (madvise(MADV_DONTNEED)), and
+//!         faulted in again by the parallel fill.
+//!         the placement matches the loops over vertices and faces (normals, point
+//!         areas, operators), which use the same static schedule. the density
+//!         kernels balance their load dynamically (by tree leaves or by sources),
+//!         and scatter into the density, so there the pages are only spread over
+//!         the nodes, rather than placed with the threads that write them.
+//!
+//!     huge pages (off by default):
+//!         large arrays are advised to use transparent huge pages (MADV_HUGEPAGE)
+//!
+//!     thread pinning:
+//!         pin the threads of the OpenMP team to the cpus allowed for the process
+//!             "compact": fill the cpus of one memory node before the next
+//!             "spread":  alternate between the memory nodes
+//!             "none":    restore the original affinity
+//!         the pinning applies to the threads of the current team size (the OpenMP
+//!         runtime reuses its threads); OMP_PROC_BIND/OMP_PLACES are an alternative
+//!
+/// ---------------------------------------------------------------------------------------
+class Numa {
+
+    //! release the (whole) pages of an array, and advise huge pages
+    static void prepare(void *ptr, const size_t nbytes);
+
+public:
+
+    //! settings
+    static void set_first_touch(const bool enable);
+    static void set_huge_pages(const bool enable);
+    static void set_min_bytes(const size_t nbytes);     //!< smaller arrays are left alone (default 2 MB)
+
+    static bool first_touch();
+    static bool huge_pages();
+    static size_t min_bytes();
+
+    //! number of memory nodes (1 if unknown)
+    static int num_nodes();
+
+    //! pin the OpenMP threads ("compact", "spread", or "none"); returns the number of threads pinned
+    static int pin_threads(const std::string &policy);
+
+#ifndef SWIG
+    //! -----------------------------------------------------------------------------------
+    //! resize data to n elements, and set data[i] = value(i)
+    //!     (in parallel with a static schedule if first touch is enabled)
+    template <typename T, typename Function>
+    static void fill(std::vector<T> &data, const size_t n, Function value) {
+
+        data.resize(n);
+
+        const size_t nbytes = n*sizeof(T);
+        const bool numa = std::is_trivially_copyable<T>::value && nbytes >= min_bytes() &&
+                          (first_touch() || huge_pages());
+
+        if (!numa) {
+            for(size_t i = 0; i < n; i++)
+                data[i] = value(i);
+            return;
+        }
+
+        prepare(data.data(), nbytes);
+
+        const long nl = long(n);
+        #pragma omp parallel for schedule(static) if(first_touch())
+        for(long i = 0; i < nl; i++)
+            data[i] = value(size_t(i));
+    }
+
+    //! assign n copies of a value (as std::vector::assign)
+    template <typename T>
+    static void assign(std::vector<T> &data, const size_t n, const T &value) {
+
+        if (n*sizeof(T) < min_bytes() || !(first_touch() || huge_pages())) {
+            data.assign(n, value);
+            return;
+        }
+        data.clear();
+        Numa::fill(data, n, [&value](const size_t) { return value; });
+    }
+#endif
+};
+
+/// ---------------------------------------------------------------------------------------
+#endif  /* _NUMA_H_ */
@@ -0,0 +1,53 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _PERIODIC_H_
+#define _PERIODIC_H_
+
+#include <vector>
+#include "Types.hpp"
+
+//! ----------------------------------------------------------------------------
+//!
+//! \brief This file provides the minimum image (in xy) of a box periodic in xy
+//!
+//! ----------------------------------------------------------------------------
+
+//! the minimum image of a displacement (for a box of widths boxw)
+inline void min_image_xy(Vertex &v, const Vertex &boxw) {
+
+    for(uint8_t d = 0; d < 2; d++) {
+        if (v[d] >  0.5*boxw[d])   v[d] -= boxw[d];
+        if (v[d] < -0.5*boxw[d])   v[d] += boxw[d];
+    }
+}
+
+//! a face with its vertices unwrapped (in xy) with respect to its first vertex
+inline void unwrap_face(const Face &f, const std::vector<Vertex> &vertices,
+                        const bool periodic, const Vertex &boxw, Vertex p[3]) {
+
+    p[0] = vertices[f[0]];
+    for(uint8_t k = 1; k < 3; k++) {
+        p[k] = vertices[f[k]];
+        if (!periodic)
+            continue;
+        for(uint8_t d = 0; d < 2; d++) {
+            if (p[k][d] - p[0][d] >  0.5*boxw[d])   p[k][d] -= boxw[d];
+            if (p[k][d] - p[0][d] < -0.5*boxw[d])   p[k][d] += boxw[d];
+        }
+    }
+}
+
+//! ---------------------------------------------------------------------------------------------
+#endif  /* _PERIODIC_H_ */
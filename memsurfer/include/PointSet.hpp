@@ -42,20 +42,44 @@ class PointSet {
     //! whether normals are available
     bool valid_normals;
 
+    //! parse the periodic box
+    void set_box(const std::vector<TypeFunction> &box);
+
+    //! duplicate the points near the boundary (within width in x and y)
+    void duplicate_boundary(const TypeFunction width[2]);
+
 public:
     //! constructor
+    PointSet() : mnPoints(0), valid_normals(false) {}
     PointSet(float *_, int n, int d);
     //PointSet(double *_, int n, int d);
 
     //! set periodicity
+    //!     the points within thickness (a fraction of the box width) of the boundary are duplicated
     void set_periodic(const std::vector<TypeFunction> &box, const TypeFunction thickness, const bool verbose = false);
 
+    //! set periodicity with a boundary layer of scale times the largest distance of
+    //!     a point to its knn-th nearest neighbor; returns the width of the layer
+    TypeFunction set_periodic_knn(const std::vector<TypeFunction> &box, const TypeIndex knn,
+                                  const TypeFunction scale = 1.5, const bool verbose = false);
+
     //! get the normals
     std::vector<TypeFunction> get_normals();
 
     //! compute the normals
     std::vector<TypeFunction> need_normals(const TypeIndex nb_neighbors, const bool verbose = false);
 
+    //! bytes held by the points (including the periodic duplicates) and normals
+    size_t memory_usage() const {
+        return mPoints.capacity()*sizeof(Point_with_normal) +
+               (mBox0.capacity() + mBox1.capacity())*sizeof(TypeFunction);
+    }
+
+    //! binary serialization (points, normals, and bbox)
+    size_t serialized_size() const;
+    size_t serialize(uint8_t *_, size_t n) const;
+    bool deserialize(const uint8_t *buffer, size_t nbytes);
+
     //! compute an approximate (Poisson) surface
 #ifdef CPP_POISSON
     TriMesh* need_approximate_surface(const bool verbose = false);
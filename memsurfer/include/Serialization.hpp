@@ -0,0 +1,133 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _SERIALIZATION_H_
+#define _SERIALIZATION_H_
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+/// ---------------------------------------------------------------------------------------
+//!
+//! \brief Raw binary serialization into a caller-provided buffer
+//!
+//!     arrays are written as a (uint64) count followed by their bytes, so that
+//!     reading them back is a single memcpy. a writer without a buffer only
+//!     counts the bytes (to size the buffer before writing)
+//!
+/// ---------------------------------------------------------------------------------------
+class ByteWriter {
+
+    uint8_t *mBuffer;
+    size_t mCapacity;
+    size_t mPos;
+
+    void put(const void *data, const size_t nbytes) {
+        if (mBuffer != nullptr) {
+            if (mPos + nbytes > mCapacity) {
+                std::ostringstream errMsg;
+                errMsg << " ByteWriter::put(): buffer of " << mCapacity << " bytes is too small!\n";
+                throw std::invalid_argument(errMsg.str());
+            }
+            if (nbytes > 0)
+                std::memcpy(mBuffer + mPos, data, nbytes);
+        }
+        mPos += nbytes;
+    }
+
+public:
+    ByteWriter(uint8_t *buffer = nullptr, const size_t capacity = 0) :
+        mBuffer(buffer), mCapacity(capacity), mPos(0) {}
+
+    size_t size() const {   return mPos;    }
+
+    template <typename T>
+    void write(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "ByteWriter::write() needs a trivially copyable type");
+        put(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void write(const std::vector<T> &values) {
+        static_assert(std::is_trivially_copyable<T>::value, "ByteWriter::write() needs a trivially copyable type");
+        write(uint64_t(values.size()));
+        put(values.data(), values.size()*sizeof(T));
+    }
+
+    void write(const std::string &value) {
+        write(uint64_t(value.size()));
+        put(value.data(), value.size());
+    }
+};
+
+/// ---------------------------------------------------------------------------------------
+class ByteReader {
+
+    const uint8_t *mBuffer;
+    size_t mCapacity;
+    size_t mPos;
+
+    void get(void *data, const size_t nbytes) {
+        if (mPos + nbytes > mCapacity) {
+            std::ostringstream errMsg;
+            errMsg << " ByteReader::get(): unexpected end of buffer (" << mCapacity << " bytes)!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+        if (nbytes > 0)
+            std::memcpy(data, mBuffer + mPos, nbytes);
+        mPos += nbytes;
+    }
+
+    size_t get_count(const size_t elemsize) {
+        uint64_t n = 0;
+        read(n);
+        if (n > (mCapacity - mPos) / (elemsize > 0 ? elemsize : 1)) {
+            std::ostringstream errMsg;
+            errMsg << " ByteReader::get_count(): invalid array of " << n << " elements!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+        return size_t(n);
+    }
+
+public:
+    ByteReader(const uint8_t *buffer, const size_t capacity) :
+        mBuffer(buffer), mCapacity(capacity), mPos(0) {}
+
+    size_t position() const {   return mPos;    }
+
+    template <typename T>
+    void read(T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "ByteReader::read() needs a trivially copyable type");
+        get(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void read(std::vector<T> &values) {
+        static_assert(std::is_trivially_copyable<T>::value, "ByteReader::read() needs a trivially copyable type");
+        values.resize(get_count(sizeof(T)));
+        get(values.data(), values.size()*sizeof(T));
+    }
+
+    void read(std::string &value) {
+        value.resize(get_count(1));
+        get(&value[0], value.size());
+    }
+};
+
+/// ---------------------------------------------------------------------------------------
+#endif  /* _SERIALIZATION_H_ */
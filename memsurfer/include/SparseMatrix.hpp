@@ -0,0 +1,131 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _SPARSE_MATRIX_H_
+#define _SPARSE_MATRIX_H_
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "Types.hpp"
+
+//! ----------------------------------------------------------------------------
+//!
+//! \brief This file provides a sparse matrix in compressed sparse row (CSR) format
+//!
+//!     built once from (row, col, value) triplets (duplicates are summed), and
+//!     applied with a parallel matrix-vector product (one row per iteration)
+//!
+//! ----------------------------------------------------------------------------
+
+class SparseMatrix {
+
+public:
+#ifndef SWIG
+    //! a (row, col, value) entry
+    struct Triplet {
+        TypeIndex row, col;
+        double value;
+        Triplet(TypeIndex r, TypeIndex c, double v) : row(r), col(c), value(v) {}
+        bool operator<(const Triplet &t) const {
+            return (row < t.row) || (row == t.row && col < t.col);
+        }
+    };
+#endif
+
+private:
+    size_t mRows, mCols;
+    std::vector<size_t> mOffsets;       //!< row i has entries mOffsets[i] to mOffsets[i+1]-1
+    std::vector<TypeIndex> mColumns;
+    std::vector<double> mValues;
+
+public:
+    SparseMatrix() : mRows(0), mCols(0), mOffsets(1, 0) {}
+
+#ifndef SWIG
+    //! build from triplets (reorders them)
+    SparseMatrix(const size_t nrows, const size_t ncols, std::vector<Triplet> &triplets) :
+        mRows(nrows), mCols(ncols) {
+
+        std::sort(triplets.begin(), triplets.end());
+
+        mOffsets.assign(nrows+1, 0);
+        mColumns.reserve(triplets.size());
+        mValues.reserve(triplets.size());
+
+        for(size_t i = 0; i < triplets.size(); i++) {
+            const Triplet &t = triplets[i];
+            if (i > 0 && triplets[i-1].row == t.row && mColumns.back() == t.col) {
+                mValues.back() += t.value;
+                continue;
+            }
+            mColumns.push_back(t.col);
+            mValues.push_back(t.value);
+            mOffsets[t.row+1]++;
+        }
+        for(size_t r = 0; r < nrows; r++)
+            mOffsets[r+1] += mOffsets[r];
+    }
+#endif
+
+    //! -----------------------------------------------------------------------------------
+    size_t nrows() const {  return mRows;           }
+    size_t ncols() const {  return mCols;           }
+    size_t nnz() const {    return mValues.size();  }
+
+    //! the csr arrays (e.g., for scipy.sparse.csr_matrix((values, columns, offsets)))
+    std::vector<TypeIndexI> get_offsets() const {   return std::vector<TypeIndexI>(mOffsets.begin(), mOffsets.end());   }
+    std::vector<TypeIndexI> get_columns() const {   return std::vector<TypeIndexI>(mColumns.begin(), mColumns.end());   }
+    std::vector<TypeFunction> get_values() const {  return std::vector<TypeFunction>(mValues.begin(), mValues.end());   }
+
+#ifndef SWIG
+    const std::vector<size_t>& offsets() const {    return mOffsets;    }
+    const std::vector<TypeIndex>& columns() const { return mColumns;    }
+    const std::vector<double>& values() const {     return mValues;     }
+
+    //! -----------------------------------------------------------------------------------
+    //! y = A x (x has ncols, and y nrows values)
+    template <typename Tin, typename Tout>
+    void multiply(const Tin *x, Tout *y) const {
+
+        const long nrows = long(mRows);
+
+        #pragma omp parallel for schedule(static)
+        for(long r = 0; r < nrows; r++) {
+            double sum = 0;
+            for(size_t k = mOffsets[r]; k < mOffsets[r+1]; k++)
+                sum += mValues[k] * double(x[mColumns[k]]);
+            y[r] = Tout(sum);
+        }
+    }
+
+    //! the transpose, scaled by s
+    SparseMatrix transpose(const double s = 1) const {
+
+        std::vector<Triplet> triplets;
+        triplets.reserve(nnz());
+        for(size_t r = 0; r < mRows; r++) {
+        for(size_t k = mOffsets[r]; k < mOffsets[r+1]; k++) {
+            triplets.push_back(Triplet(mColumns[k], TypeIndex(r), s*mValues[k]));
+        }}
+        return SparseMatrix(mCols, mRows, triplets);
+    }
+#endif
+};
+
+//! ----------------------------------------------------------------------------
+//! ----------------------------------------------------------------------------
+
+#endif /* _SPARSE_MATRIX_H_ */
@@ -0,0 +1,308 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#ifndef _TASK_GRAPH_H_
+#define _TASK_GRAPH_H_
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <unordered_map>
+#include <condition_variable>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/// ---------------------------------------------------------------------------------------
+//!
+//! \brief A lightweight work-stealing executor for a graph of tasks
+//!
+//!     every task declares the (named) data it reads and writes; a task runs after
+//!     the last earlier writer of its inputs, and after all earlier readers and the
+//!     last earlier writer of its outputs (i.e., in the order they were added,
+//!     wherever they conflict). independent tasks run concurrently.
+//!
+//!     every worker owns a deque of jobs: it pops its own jobs from the back, and
+//!     steals from the front of the others' when it runs out.
+//!
+//!     nested parallelism:
+//!         OpenMP loops inside a task get an equal share of the threads, i.e.,
+//!             (omp threads of the caller) / (number of tasks running)
+//!
+//!     the first exception thrown by a task is rethrown by run(); the tasks
+//!     that were not started by then are skipped
+//!
+/// ---------------------------------------------------------------------------------------
+class TaskGraph {
+
+    typedef std::function<void()> Job;
+
+    struct Task {
+        std::string name;
+        Job fn;
+        std::vector<size_t> successors;
+        size_t npredecessors;
+        std::atomic<size_t> pending;
+        Task() : npredecessors(0), pending(0) {}
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // the graph
+    std::deque<Task> mTasks;
+    std::unordered_map<std::string, size_t> mLastWriter;
+    std::unordered_map<std::string, std::vector<size_t> > mReaders;
+
+    // the execution
+    std::vector<WorkQueue> mQueues;
+    std::atomic<size_t> mRemaining;
+    std::atomic<int> mActive;
+    std::atomic<bool> mFailed;
+    int mOmpThreads;
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::exception_ptr mError;
+
+    //! the worker executing on this thread (per graph)
+    static int& worker_id() {
+        static thread_local int id = -1;
+        return id;
+    }
+    static const TaskGraph*& worker_graph() {
+        static thread_local const TaskGraph *graph = nullptr;
+        return graph;
+    }
+    int my_worker() const {
+        return (worker_graph() == this) ? worker_id() : -1;
+    }
+
+    //! -----------------------------------------------------------------------------------
+    void push(const int w, Job job) {
+        {
+            std::lock_guard<std::mutex> lock(mQueues[w].mutex);
+            mQueues[w].jobs.push_back(std::move(job));
+        }
+        mWake.notify_one();
+    }
+
+    bool pop(const int w, Job &job) {
+
+        // own jobs (newest first)
+        {
+            std::lock_guard<std::mutex> lock(mQueues[w].mutex);
+            if (!mQueues[w].jobs.empty()) {
+                job = std::move(mQueues[w].jobs.back());
+                mQueues[w].jobs.pop_back();
+                return true;
+            }
+        }
+
+        // steal (oldest first)
+        const int nworkers = int(mQueues.size());
+        for(int k = 1; k < nworkers; k++) {
+            WorkQueue &q = mQueues[(w + k) % nworkers];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.jobs.empty()) {
+                job = std::move(q.jobs.front());
+                q.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void fail() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mError)
+            mError = std::current_exception();
+        mFailed = true;
+    }
+
+    //! -----------------------------------------------------------------------------------
+    void execute(const size_t t) {
+
+        Task &task = mTasks[t];
+        if (!mFailed) {
+
+            const int nactive = ++mActive;
+#ifdef _OPENMP
+            omp_set_num_threads(std::max(1, mOmpThreads / nactive));
+#endif
+            try {
+                task.fn();
+            }
+            catch (...) {
+                fail();
+            }
+            --mActive;
+        }
+
+        // release the successors
+        const int w = my_worker();
+        for(auto iter = task.successors.begin(); iter != task.successors.end(); ++iter) {
+            if (--mTasks[*iter].pending == 0) {
+                const size_t s = *iter;
+                push(w, [this, s]{ this->execute(s); });
+            }
+        }
+
+        if (--mRemaining == 0) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mWake.notify_all();
+        }
+    }
+
+    void work(const int w) {
+
+        worker_id() = w;
+        worker_graph() = this;
+
+        Job job;
+        while (mRemaining > 0) {
+            if (pop(w, job)) {
+                job();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait_for(lock, std::chrono::microseconds(200));
+        }
+
+        worker_graph() = nullptr;
+        worker_id() = -1;
+    }
+
+    //! add an edge (once)
+    void depend(const size_t from, const size_t to) {
+        if (from == to)
+            return;
+        std::vector<size_t> &succ = mTasks[from].successors;
+        if (std::find(succ.begin(), succ.end(), to) != succ.end())
+            return;
+        succ.push_back(to);
+        mTasks[to].npredecessors++;
+    }
+
+public:
+
+    TaskGraph() : mRemaining(0), mActive(0), mFailed(false), mOmpThreads(1) {}
+
+    size_t size() const {   return mTasks.size();   }
+
+    //! -----------------------------------------------------------------------------------
+    //! add a task that reads inputs and writes outputs (names of data); returns its id
+    size_t add(const std::string &name, const std::vector<std::string> &inputs,
+               const std::vector<std::string> &outputs, Job fn) {
+
+        const size_t t = mTasks.size();
+        mTasks.emplace_back();
+        mTasks.back().name = name;
+        mTasks.back().fn = std::move(fn);
+
+        // read after write
+        for(auto iter = inputs.begin(); iter != inputs.end(); ++iter) {
+            auto w = mLastWriter.find(*iter);
+            if (w != mLastWriter.end())
+                depend(w->second, t);
+        }
+
+        // write after write, and write after read
+        for(auto iter = outputs.begin(); iter != outputs.end(); ++iter) {
+            auto w = mLastWriter.find(*iter);
+            if (w != mLastWriter.end())
+                depend(w->second, t);
+
+            std::vector<size_t> &readers = mReaders[*iter];
+            for(auto r = readers.begin(); r != readers.end(); ++r)
+                depend(*r, t);
+            readers.clear();
+            mLastWriter[*iter] = t;
+        }
+
+        for(auto iter = inputs.begin(); iter != inputs.end(); ++iter) {
+            mReaders[*iter].push_back(t);
+        }
+        return t;
+    }
+
+    //! -----------------------------------------------------------------------------------
+    //! run all tasks on nworkers threads (including the caller); 0 = all cores
+    void run(int nworkers = 0) {
+
+        const size_t ntasks = mTasks.size();
+        if (ntasks == 0)
+            return;
+
+        if (nworkers <= 0)
+            nworkers = std::max(1, int(std::thread::hardware_concurrency()));
+        nworkers = std::min(nworkers, int(ntasks));
+
+#ifdef _OPENMP
+        mOmpThreads = omp_get_max_threads();
+#endif
+        mQueues = std::vector<WorkQueue>(nworkers);
+        mRemaining = ntasks;
+        mActive = 0;
+        mFailed = false;
+        mError = nullptr;
+
+        // distribute the roots
+        int w = 0;
+        for(size_t t = 0; t < ntasks; t++) {
+            mTasks[t].pending = mTasks[t].npredecessors;
+            if (mTasks[t].npredecessors == 0) {
+                mQueues[w].jobs.push_back([this, t]{ this->execute(t); });
+                w = (w+1) % nworkers;
+            }
+        }
+
+        std::vector<std::thread> threads;
+        for(int i = 1; i < nworkers; i++) {
+            threads.push_back(std::thread(&TaskGraph::work, this, i));
+        }
+
+        // the caller is a worker too
+        const int prev_id = worker_id();
+        const TaskGraph *prev_graph = worker_graph();
+        this->work(0);
+        worker_id() = prev_id;
+        worker_graph() = prev_graph;
+
+        for(auto iter = threads.begin(); iter != threads.end(); ++iter) {
+            iter->join();
+        }
+#ifdef _OPENMP
+        omp_set_num_threads(mOmpThreads);
+#endif
+        mQueues.clear();
+
+        if (mError) {
+            std::rethrow_exception(mError);
+        }
+    }
+};
+
+/// ---------------------------------------------------------------------------------------
+#endif  /* _TASK_GRAPH_H_ */
@@ -17,13 +17,18 @@ For details, see https://github.com/LLNL/MemSurfer.
 
 #include <cstdio>
 #include <tuple>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
 #include "Types.hpp"
+#include "Numa.hpp"
 
 class DensityKernel;        // kernel for density estimation
 class DistanceKernel;
+class ByteWriter;           // binary serialization
+class HeatSolver;           // factorized diffusion operator
+class SparseMatrix;         // discrete operators
 
 /// ---------------------------------------------------------------------------------------
 //!
@@ -32,6 +37,12 @@ class DistanceKernel;
 /// ---------------------------------------------------------------------------------------
 class TriMesh {
 
+    //! accumulates fields over frames (needs the planar geometry)
+    friend class FieldAccumulator;
+    //! diffs the planar neighbor graph across frames
+    friend class ContactLifetimes;
+    friend class MeshTasks;
+
 private:
     //! Dimensionality of mesh (planar = 2D, surface = 3D)
     uint8_t mDim;
@@ -108,6 +119,62 @@ private:
     std::vector<TypeFunction> mgeodesics;
 #endif
 
+    //! Factorized diffusion operator (for the heat density; shared by copies of the mesh)
+    std::shared_ptr<const HeatSolver> mHeat;
+
+    //! Discrete operators (TriMesh_operators.cpp; shared by copies of the mesh)
+    enum Operator { OP_LAPLACIAN, OP_MASS_LUMPED, OP_MASS, OP_GRADIENT, OP_DIVERGENCE, NOPERATORS };
+    std::shared_ptr<const SparseMatrix> mOperators[NOPERATORS];
+
+    //! Region of interest: the vertices within mROIRadius (in xy) of any of the centers
+    //!     (no centers = the whole mesh), or the given vertices (mROIGiven)
+    std::vector<Vertex> mROICenters;
+    TypeFunction mROIRadius;
+    bool mROIGiven;
+    std::vector<TypeIndexI> mROI;
+
+    //! -----------------------------------------------------------------------------------
+    //! Versions of the geometry (vertex positions), topology (faces), and region of interest
+    //!     every cached property (normals, fields, geodesics) is stamped with the
+    //!     versions it was computed from, and is recomputed when they change
+    //!     only the properties restricted to the region of interest (densities,
+    //!     curvatures, and the region itself) are stamped with its version (else 0)
+    //! -----------------------------------------------------------------------------------
+
+    struct Stamp {
+        uint64_t geometry, topology, roi;
+    };
+
+    uint64_t mGeometryVersion, mTopologyVersion, mROIVersion;
+    std::unordered_map<std::string, Stamp> mStamps;
+
+    void stamp(const std::string &name, const bool roi = false) {
+        mStamps[name] = Stamp{mGeometryVersion, mTopologyVersion, roi ? mROIVersion : 0};
+    }
+
+    //! is the cached property (a field name, or "_normals", "_geodesics", "_op_*") up to date?
+    bool is_current(const std::string &name) const {
+        auto iter = mStamps.find(name);
+        if (iter == mStamps.end())
+            return false;
+        const Stamp &s = iter->second;
+        return s.geometry == mGeometryVersion && s.topology == mTopologyVersion &&
+               (s.roi == 0 || s.roi == mROIVersion);
+    }
+
+    //! create the (stale) entries of a cached property ahead of computing it, so that
+    //!     computing different properties concurrently does not modify the maps
+    void reserve(const std::string &name, const bool field) {
+        if (field)
+            mFields[name];
+        if (mStamps.find(name) == mStamps.end())
+            mStamps[name] = Stamp{UINT64_MAX, UINT64_MAX, 0};
+    }
+
+    void geometry_changed() {   mGeometryVersion++;     }
+    void topology_changed() {   mTopologyVersion++;     }
+    void roi_changed() {        mROIVersion++;          }
+
     //! -----------------------------------------------------------------------------------
     //! Static methods to compute properties of interest
     //! -----------------------------------------------------------------------------------
@@ -141,16 +208,15 @@ private:
 
         static_assert((D == 2 || D == 3), "TriMesh::delinearize() expects 2 or 3 dimensional array");
 
-        data.resize(n);
+        // first touch by the threads that own these elements (see Numa.hpp)
         if (d == 3) {
-            for (size_t i=0; i<n; i++) {
-                data[i] = Vec<D,T>(_[3*i], _[3*i+1], _[3*i+2]);
-            }
+            Numa::fill(data, n, [_](const size_t i) { return Vec<D,T>(_[3*i], _[3*i+1], _[3*i+2]); });
         }
         else if(d == 2) {
-            for (size_t i=0; i<n; i++) {
-                data[i] = Vec<D,T>(_[2*i], _[2*i+1], 0.0);
-            }
+            Numa::fill(data, n, [_](const size_t i) { return Vec<D,T>(_[2*i], _[2*i+1], 0.0); });
+        }
+        else {
+            data.resize(n);
         }
         return true;
     }
@@ -192,6 +258,29 @@ private:
     //! project a set of points on the surface (using cgal)
     std::vector<TypeFunction> project_on_surface(const std::vector<Point3> &points, bool verbose = false) const;
 
+    //! Delaunay tessellation field estimator (TriMesh_dtfe.cpp)
+    void dtfe(const std::vector<TypeIndexI> &ids, std::vector<TypeFunction> &density) const;
+
+    //! diffusion of the ids for time sigma^2 / 2 (TriMesh_heat.cpp)
+    void kde_heat(const std::vector<TypeIndexI> &ids, const TypeFunction sigma,
+                  std::vector<TypeFunction> &density, bool verbose = false);
+
+    //! bytes held by the factorized diffusion operator (TriMesh_heat.cpp)
+    size_t heat_memory_usage() const;
+
+    //! the (cached) discrete operator op, and the index of an operator name
+    const SparseMatrix& need_operator(const int op, bool verbose = false);
+    int operator_index(const std::string &name) const;
+
+    //! the vertices in the region of interest (TriMesh_roi.cpp)
+    //!     need_roi() caches them, and is empty if there is no region
+    bool has_roi() const {      return mROIGiven || !mROICenters.empty();   }
+    std::vector<TypeIndexI> roi_vertices() const;
+    const std::vector<TypeIndexI>& need_roi();
+
+    //! write the state of the mesh (TriMesh_serialize.cpp)
+    void serialize(ByteWriter &writer) const;
+
 public:
 
     //! -----------------------------------------------------------------------------------
@@ -199,10 +288,10 @@ public:
     //! -----------------------------------------------------------------------------------
 
     //! Constructors
-    TriMesh() : mDim(0) {
+    TriMesh() : mDim(0), mROIRadius(0), mROIGiven(false), mGeometryVersion(0), mTopologyVersion(0), mROIVersion(1) {
         this->mPeriodic = false;
     }
-    TriMesh(float *_, int n, int d) {
+    TriMesh(float *_, int n, int d) : mROIRadius(0), mROIGiven(false), mGeometryVersion(0), mTopologyVersion(0), mROIVersion(1) {
         this->mPeriodic = false;
         this->set_dimensionality(d);
         this->set_vertices(_,n,d);
@@ -219,16 +308,28 @@ public:
     //! -----------------------------------------------------------------------------------
     //! Set and get vertices and faces
     bool set_vertices(float *_, int n, int d) {
+        this->geometry_changed();
         return this->delinearize<3,TypeFunction,float>(_,n,d,mVertices);
     }
     bool set_faces(uint32_t *_, int n, int d) {
+        this->topology_changed();
         return this->delinearize<3,TypeIndex,uint32_t>(_,n,d,mFaces);
     }
     bool set_faces(const TriMesh &mesh) {
+        this->topology_changed();
         mFaces = mesh.mFaces;
         return true;
     }
 
+    //! update the positions of the vertices in place (e.g., for the next frame)
+    //!     keeps the faces and all buffers; cached properties become stale
+    //!     and are recomputed (into the same buffers) when next requested
+    bool update_vertices(float *_, int n, int d);
+
+    //! the versions of the geometry and topology
+    uint64_t geometry_version() const {     return mGeometryVersion;    }
+    uint64_t topology_version() const {     return mTopologyVersion;    }
+
     //! The number of vertices and faces
     size_t nvertices() const {  return mVertices.size();    }
     size_t nfaces() const {     return mFaces.size();       }
@@ -246,21 +347,23 @@ public:
         for(int i = 0; i < n; i++){
           v[i] = _[i];
         }
+        stamp(key);
         return true;
     }
     bool set_fields(const TriMesh &mesh, std::string key) {
         for (auto iter = mesh.mFields.begin(); iter != mesh.mFields.end(); iter++) {
             if (iter->first.find(key) == 0) {
                 this->mFields[iter->first] = iter->second;
+                stamp(iter->first);
             }
         }
         return true;
     }
 
-    //! Return linearized field
+    //! Return linearized field (empty if it does not exist, or is stale)
     std::vector<TypeFunction> get_field(const std::string &name) const {
         auto iter = mFields.find(name);
-        return (iter != mFields.end()) ? iter->second : std::vector<TypeFunction> ();
+        return (iter != mFields.end() && is_current(name)) ? iter->second : std::vector<TypeFunction> ();
     }
 
     //! -----------------------------------------------------------------------------------
@@ -319,8 +422,8 @@ public:
     //! Compute vertex normals
     const std::vector<TypeFunction> need_normals(bool verbose = false) {
 
-        // Compute only if point areas are not available
-        if (this->mPointNormals.size() != this->mVertices.size()) {
+        // Compute only if normals are not available (or stale)
+        if (!is_current("_normals")) {
 
             if (verbose) {
                 std::cout << "   > " << tag() << "::need_normals()...";
@@ -342,6 +445,7 @@ public:
                 this->mFaceNormals.resize(this->mFaces.size());
                 this->mPointNormals.resize(this->mVertices.size());
             }
+            stamp("_normals");
 
             if(verbose)
                 std::cout << " Done!\n";
@@ -352,8 +456,8 @@ public:
     //! Compute per-vertex point areas
     const std::vector<TypeFunction>& need_pointareas(bool verbose = false) {
 
-        // Compute only if point areas are not available
-        if (mFields.find("point_areas") == mFields.end()) {
+        // Compute only if point areas are not available (or stale)
+        if (!is_current("point_areas")) {
 
             if (verbose) {
                 std::cout << "   > " << tag() << "::need_pointareas()...";
@@ -373,6 +477,7 @@ public:
                 TriMesh::need_pointareas(faces, vertices, mFields["point_areas"]);
                 mFields["point_areas"].resize(this->mVertices.size());
             }
+            stamp("point_areas");
 
             if(verbose)
                 std::cout << " Done!\n";
@@ -383,10 +488,25 @@ public:
     //! Compute curvature (using vtk)
     std::vector<TypeFunction> need_curvature(bool verbose = false);             // TriMesh_vtk.cpp
 
+    //! Compute the tilt of lipids with respect to the point normals
+    //!     heads and tails (n x 3) are paired with the vertices (n = nvertices)
+    //!     returns (and stores as fields) the angle (degrees) between head-tail
+    //!     vector and normal ("tilt_angle"), and the unit in-plane component
+    //!     of the head-tail vector ("tilt_director_x", "_y", "_z"): n x 4 values
+    std::vector<TypeFunction> need_tilt(float *heads, int nh, int dh, float *tails, int nt, int dt,
+                                        bool verbose = false);
+
     //! compute the mesh as 2D Delaunay (using cgal)
     std::vector<TypeIndexI> delaunay(bool verbose = false);
     std::vector<TypeIndexI> periodicDelaunay(bool verbose = false);
 
+    //! compute the mesh as 2D regular (weighted Delaunay) triangulation (using cgal)
+    //!     the weights (one per vertex) are squared radii, e.g., of the lipid species;
+    //!     also stores the areas of the power cells as a field ("area_power")
+    //!     (0 for vertices hidden by their neighbors)
+    std::vector<TypeIndexI> regular(float *_, int n, bool verbose = false);
+    std::vector<TypeIndexI> periodicRegular(float *_, int n, bool verbose = false);
+
     //! compute the distance of "this" mesh from the "other" mesh
     std::vector<TypeFunction> distance_to_other_mesh(const TriMesh &other, bool verbose=false) const;
 
@@ -397,21 +517,95 @@ public:
     //! project a set of points on the triangulation (using cgal)
     std::vector<TypeFunction> project_on_surface(const std::vector<TypeFunction> &points, bool verbose = false) const;
 
+    //! Taubin (lambda|mu) smoothing, periodic in xy; returns the smoothed vertices
+    std::vector<TypeFunction> smooth_taubin(const TypeFunction lambda = 0.5, const TypeFunction mu = -0.53,
+                                            const int niters = 10, bool verbose = false) const;
+
+    //! decimate the surface by quadric-error edge collapses (TriMesh_decimate.cpp)
+    //!     boundary vertices are not moved or removed
+    //!     stops at target_nverts vertices, or before the first collapse whose
+    //!     quadric error exceeds max_error^2 (ignored if negative)
+    //!     invalidates all fields, and returns the new number of vertices
+    size_t decimate(const size_t target_nverts, const TypeFunction max_error = -1, bool verbose = false);
+
     //! -----------------------------------------------------------------------------------
     //! Compute density
     //! -----------------------------------------------------------------------------------
+    //!     tolerance = 0 computes the exact sum over all pairs
+    //!     tolerance > 0 (types 2 and 3) bounds the relative error using a dual-tree
+    //!     knn > 0 (types 2 and 3) scales the bandwidth of each source by its
+    //!         distance to the knn-th nearest source (adaptive density)
+    //!     type 4 is the (parameter-free) Delaunay tessellation field estimator
+    //!         on the faces of this mesh, or, for the given ids, on the Delaunay
+    //!         triangulation of those vertices (the kernels are not used)
+    //!     type 5 diffuses the points on this mesh for time sigma^2 / 2 (the
+    //!         geodesic Gaussian, without all-pairs distances): the sigma of the
+    //!         (Gaussian) density kernel is used, and the distance kernel is not
     const std::vector<TypeFunction>&
         kde(const std::string &name, const int type, const bool get_counts,
             const DensityKernel& dens_kern, const DistanceKernel& dist_kern,
-            const bool verbose = false) {
+            const TypeFunction tolerance = 0, const int knn = 0, const bool verbose = false) {
 
         return TriMesh::kde(name, type, get_counts, dens_kern, dist_kern,
-                            std::vector<TypeIndexI>(), verbose);
+                            std::vector<TypeIndexI>(), tolerance, knn, verbose);
     }
     const std::vector<TypeFunction>&
         kde(const std::string &name, const int type, const bool get_counts,
             const DensityKernel& dens_kern, const DistanceKernel& dist_kern,
-            const std::vector<TypeIndexI> &ids, const bool verbose = false);
+            const std::vector<TypeIndexI> &ids, const TypeFunction tolerance = 0,
+            const int knn = 0, const bool verbose = false);
+
+    //! linear interpolation of a field at query points (n x d, d >= 2), located in xy
+    //!     returns nan for points outside the mesh
+    std::vector<TypeFunction> interpolate_field(const std::string &name, float *_, int n, int d) const;
+
+    //! resample the fields (all vertex fields if none) of another mesh at the vertices
+    //!     of this mesh, located in the xy triangulation of the other (TriMesh_transfer.cpp)
+    //!     stores them as fields prefix + name of this mesh (nan outside the other mesh),
+    //!     which may not be the ones this mesh caches, and returns their names
+    std::vector<std::string> transfer_fields(const TriMesh &from, const std::vector<std::string> &names,
+                                             const std::string &prefix = "xfer_", bool verbose = false);
+
+    //! -----------------------------------------------------------------------------------
+    //! Region of interest (TriMesh_roi.cpp)
+    //! -----------------------------------------------------------------------------------
+    //!     restricts the expensive properties to the vertices within radius (in xy, with
+    //!     the periodic minimum image) of the centers (n x d, d >= 2): densities of type
+    //!     2 and 3 are evaluated only there (and all types are nan elsewhere, with
+    //!     get_counts not available), curvatures are computed on the faces around them,
+    //!     and distances to another mesh only for them (nan elsewhere)
+    //!     setting or clearing the region invalidates only the properties restricted to it
+    void set_roi(float *_, int n, int d, const float radius);
+    void clear_roi();
+
+    //! restrict to the given vertices instead (e.g., those owned by a tile of the domain)
+    void set_roi_vertices(int *_, int n);
+
+    //! the vertices in the region of interest (all if there is none)
+    std::vector<TypeIndexI> get_roi();
+
+    //! the points (n x d, d >= 2) in the region of interest (e.g., to project only those)
+    std::vector<TypeIndexI> in_roi(float *_, int n, int d) const;
+
+    //! -----------------------------------------------------------------------------------
+    //! Discrete operators (TriMesh_operators.cpp)
+    //! -----------------------------------------------------------------------------------
+    //!     built when first requested, and cached until the geometry or topology changes
+    //!     the faces are those of periodic_faces(combined = true), unwrapped in xy
+    //!         "laplacian":    cotangent Laplacian L (nv x nv, positive semi-definite)
+    //!         "mass_lumped":  diagonal mass matrix (point areas, nv x nv)
+    //!         "mass":         consistent (linear finite element) mass matrix (nv x nv)
+    //!         "gradient":     per-face gradient G of a vertex function (3nf x nv;
+    //!                         rows 3f, 3f+1, 3f+2 are the x, y, z components of face f)
+    //!         "divergence":   integrated divergence D = -G^T A (nv x 3nf), A = face areas,
+    //!                         so that D G = -L
+
+    //! a copy of an operator (its csr arrays can be passed to scipy)
+    SparseMatrix get_operator(const std::string &name, bool verbose = false);
+
+    //! apply an operator to a field, and store the result as the field out
+    std::vector<TypeFunction> apply_operator(const std::string &name, const std::string &field,
+                                             const std::string &out, bool verbose = false);
 
     //! -----------------------------------------------------------------------------------
 
@@ -425,6 +619,27 @@ public:
     void remesh(bool verbose = false);
 #endif
 
+    /// ---------------------------------------------------------------------------------------
+    //! binary serialization (e.g., for pickling, or to copy into shared memory)
+    //!     includes the vertices, faces, periodic data, bbox, and the current
+    //!     normals and fields (not the geodesics)
+    //!     serialize needs a buffer of serialized_size() bytes, and returns the bytes written
+    size_t serialized_size() const;
+    size_t serialize(uint8_t *_, size_t n) const;
+    bool deserialize(const uint8_t *buffer, size_t nbytes);
+
+    /// ---------------------------------------------------------------------------------------
+    //! memory (TriMesh_memory.cpp)
+    //!     bytes held by the buffers of the mesh (all, or only the caches that can be recomputed)
+    size_t memory_usage(bool caches_only = false) const;
+
+    //! free the caches that are recomputed on request: adjacency, geodesics,
+    //!     discrete operators, and the factorized diffusion operator
+    void release_caches();
+
+    //! free the fields, except the given ones (recomputed on request)
+    void release_fields(const std::vector<std::string> &keep = std::vector<std::string>());
+
     /// ---------------------------------------------------------------------------------------
     //! read/write off format
     static bool read_off(const std::string &fname, std::vector<Vertex> &vertices, std::vector<Face> &faces, bool verbose = false);
@@ -432,6 +647,8 @@ public:
 
     bool read_off(const std::string &fname, bool verbose = false) {
         this->mDim = 3;
+        this->geometry_changed();
+        this->topology_changed();
         return TriMesh::read_off(fname, mVertices, mFaces, verbose);
     }
     bool write_off(const std::string &fname, bool verbose = false) const {
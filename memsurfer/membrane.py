@@ -29,6 +29,9 @@ class Membrane(object):
        Class to create and manipulate membrane surfaces
     '''
 
+    # retention policies of the intermediates (see release())
+    RETAIN = ('all', 'outputs', 'minimal')
+
     # --------------------------------------------------------------------------
     # constructor
     def __init__(self, points, **kwargs):
@@ -39,8 +42,20 @@ class Membrane(object):
                 periodic:       boolean flag for periodicity (default: False)
                 bbox:           ndarray of shape (nverts, 3)
                                     required for periodic domain
-                boundary_layer: float value for boundary layer thickess (default: 0.2)
-                                    used only for periodic domain
+                boundary_layer: thickness of the boundary layer of duplicated points
+                                    (used only for periodic domain)
+                                    'knn' (default): sized by the neighborhoods used for the normals
+                                    float: fraction of the box width (e.g., 0.2)
+                roi_centers:    ndarray of shape (n, 2/3), e.g., atoms of embedded proteins
+                roi_radius:     radius (in xy) of the region of interest around them
+                                    the properties are then computed only in this region
+                radii:          radius of every label, {label: radius}
+                                    triangulates the points as a power diagram
+                                    (weighted by the footprints of the lipids), and
+                                    stores the power cell areas (in the planar
+                                    parameterization) as 'area_power'
+        retain:         which intermediates to keep (see release())
+                                    'all' (default), 'outputs', or 'minimal'
         '''
         # 3d points
         if points.shape[1]!= 3:
@@ -52,7 +67,7 @@ class Membrane(object):
         # periodicity information
         self.periodic = kwargs.get('periodic', False)
         if self.periodic:
-            self.blayer = kwargs.get('boundary_layer', 0.2)
+            self.blayer = kwargs.get('boundary_layer', 'knn')
             if 'bbox' not in list(kwargs.keys()):
                 raise ValueError('Periodic membrane needs 3D bounding box: ndarray (2 ,3)')
 
@@ -84,6 +99,21 @@ class Membrane(object):
         # other properties
         self.properties = {}
 
+        # footprints of the lipids
+        self.radii = kwargs.get('radii', None)
+        if self.radii is not None and self.labels.shape == (0,0):
+            raise ValueError('Membrane needs labels to use the radii of lipids')
+
+        # retention policy of the intermediates
+        self.retain = kwargs.get('retain', 'all')
+        if self.retain not in Membrane.RETAIN:
+            raise ValueError('Invalid retention policy ({}). Should be one of {}'.format(self.retain, Membrane.RETAIN))
+
+        # region of interest
+        self.roi = None
+        if 'roi_centers' in list(kwargs.keys()):
+            self.set_roi(kwargs['roi_centers'], kwargs.get('roi_radius', 30.))
+
     # --------------------------------------------------------------------------
     def fit_points_to_box_xy(self):
         '''
@@ -108,6 +138,46 @@ class Membrane(object):
 
         return nadjusted
 
+    # --------------------------------------------------------------------------
+    def set_roi(self, centers, radius):
+        '''
+            Restrict the expensive properties (densities, curvature, thickness) to
+            the vertices within radius (in xy, periodic) of the centers
+                centers = None removes the region of interest
+        '''
+        if centers is None:
+            self.roi = None
+        else:
+            self.roi = (np.asarray(centers, dtype=np.float32), float(radius))
+        self.apply_roi()
+
+    def apply_roi(self):
+        # (the planar mesh is in parameterized coordinates, not in xy)
+        for m in ['memb_smooth', 'memb_exact']:
+            if not hasattr(self, m):
+                continue
+            if self.roi is None:
+                getattr(self, m).clear_roi()
+            else:
+                getattr(self, m).set_roi(self.roi[0], self.roi[1])
+
+    # --------------------------------------------------------------------------
+    def triangulate_planar(self):
+        '''
+            Triangulate the planar points: Delaunay, or regular (weighted by the
+            squared radii of the lipids) if radii are given
+        '''
+        if self.radii is None:
+            self.memb_planar.delaunay()
+            return
+
+        missing = set(np.unique(self.labels)) - set(self.radii.keys())
+        if len(missing) > 0:
+            raise ValueError('Radii not given for labels {}'.format(sorted(missing)))
+
+        weights = np.array([self.radii[l] for l in self.labels], dtype=np.float32) ** 2
+        self.properties['area_power'] = self.memb_planar.regular(weights)
+
     # --------------------------------------------------------------------------
     def compute_pnormals(self, knbrs=18, ndir_hint=+1):
         '''
@@ -122,8 +192,13 @@ class Membrane(object):
         mtimer = Timer()
 
         # this function will duplicate points within the boundary layer
+        # (of the knbrs-neighborhoods, or a fraction of the box)
         if self.periodic:
-            self.pset.set_periodic(self.bbox.reshape(-1).tolist(), self.blayer, cverbose)
+            if self.blayer == 'knn':
+                width = self.pset.set_periodic_knn(self.bbox.reshape(-1).tolist(), knbrs, 1.5, cverbose)
+                LOGGER.info('\t boundary layer = {}'.format(width))
+            else:
+                self.pset.set_periodic(self.bbox.reshape(-1).tolist(), self.blayer, cverbose)
 
         self.pset.need_normals(knbrs, cverbose)
         normals = self.pset.get_normals()
@@ -142,16 +217,36 @@ class Membrane(object):
         mtimer.end()
         LOGGER.info('Computed {} normals! took {}'.format(self.pnormals.shape, mtimer))
         LOGGER.info('\t normals = {} {}'.format(self.pnormals.min(axis=0),self.pnormals.max(axis=0)))
+
+        # the point set is needed only for the normals
+        if self.retain != 'all':
+            self.pset = None
         return self.pnormals
 
     # --------------------------------------------------------------------------
-    def compute_approx_surface(self, exactness_level=10):
+    def compute_approx_surface(self, exactness_level=10, previous=None, reuse_tolerance=0.):
         '''
             Compute an approximating surface using Poisson recronstruction
                 exactness_level:  controls the smoothness
                         larger exactness_level will fit the points more --> less smooth
+                previous:         membrane of the previous frame (trajectory mode)
+                reuse_tolerance:  reuse the Poisson surface (and its parameterization) of
+                        the previous frame if the rms displacement of the points (from the
+                        points the surface was computed for) is below this tolerance
+                        (the points are only projected on it again)
         '''
         self.compute_pnormals()
+        self.poisson_reused = False
+
+        if previous is not None and reuse_tolerance > 0.:
+            rms = self.rms_displacement(previous)
+            if rms is not None and rms < reuse_tolerance:
+                LOGGER.info('Reusing Poisson surface of the previous frame (rms displacement = {} < {})'
+                            .format(rms, reuse_tolerance))
+                self.surf_poisson = previous.surf_poisson
+                self.poisson_ref_points = previous.poisson_ref_points
+                self.poisson_reused = True
+                return
 
         LOGGER.info('Computing Poisson surface for {} points'.format(self.npoints))
         mtimer = Timer()
@@ -164,12 +259,49 @@ class Membrane(object):
 
         # represent the poisson surface as a triangulation
         self.surf_poisson = TriMesh(sverts, faces=sfaces, label='surf_poisson')
+        self.poisson_ref_points = self.points.copy()
 
         #self.surf_poisson.write_vtp('_temp3.vtp', {})#params)
         #self.surf_poisson.remesh()
         #self.surf_poisson.write_vtp('_temp3_remeshed.vtp', {})#params)
         self.surf_poisson.display()
 
+    # --------------------------------------------------------------------------
+    def rms_displacement(self, other):
+        '''
+            The rms displacement of the points from the (same) points the Poisson
+                surface of another membrane was computed for (closest periodic image
+                in xy), or None if they do not match (so the drift over a chain of
+                reuses is bounded as well)
+        '''
+        if not hasattr(other, 'surf_poisson') or not hasattr(other, 'poisson_ref_points'):
+            return None
+        if other.poisson_ref_points.shape != self.points.shape:
+            return None
+
+        disp = self.points - other.poisson_ref_points
+        if self.periodic:
+            boxw = self.bbox[1,:2] - self.bbox[0,:2]
+            disp[:,:2] -= boxw * np.round(disp[:,:2] / boxw)
+
+        return float(np.sqrt(np.mean(np.sum(disp*disp, axis=1))))
+
+    # --------------------------------------------------------------------------
+    def decimate_approx_surface(self, target_nverts=None, max_error=-1.):
+        '''
+            Decimate the Poisson surface (before parameterization)
+                target_nverts:  number of vertices to keep (default: number of points)
+                max_error:      stop before a collapse with a larger (quadric) error
+        '''
+        if getattr(self, 'poisson_reused', False):
+            return
+
+        if target_nverts is None:
+            target_nverts = 0 if max_error >= 0 else self.npoints
+
+        self.surf_poisson.decimate(target_nverts, max_error)
+        self.surf_poisson.display()
+
     # --------------------------------------------------------------------------
     def compute_membrane_surface(self):
         '''
@@ -196,6 +328,9 @@ class Membrane(object):
             bb1 = self.surf_poisson.pverts.max(axis=0)
             self.memb_planar.set_bbox(bb0, bb1)
 
+            # the period of the parameterization (used by the periodic delaunay)
+            self.pperiod = (bb1 - bb0)[:2]
+
             # bounding box of the points projected on the surface
             bb0 = self.spoints.min(axis=0)
             bb1 = self.spoints.max(axis=0)
@@ -206,8 +341,8 @@ class Membrane(object):
             bb1 = self.points.max(axis=0)
             self.memb_exact.set_bbox(bb0, bb1)
 
-        # compute delaunay triangulation of the planar points
-        self.memb_planar.delaunay()
+        # compute delaunay (or regular) triangulation of the planar points
+        self.triangulate_planar()
         self.memb_smooth.copy_triangulation(self.memb_planar)
         self.memb_exact.copy_triangulation(self.memb_planar)
 
@@ -218,6 +353,68 @@ class Membrane(object):
             bb1 = self.ppoints.max(axis=0)
             self.memb_planar.set_bbox(bb0, bb1)
 
+        self.apply_roi()
+        self.release_projections()
+
+        # the poisson surface is not needed anymore (and is not reused by the next frame)
+        if self.retain == 'minimal':
+            del self.surf_poisson
+            del self.poisson_ref_points
+
+    # --------------------------------------------------------------------------
+    def compute_membrane_surface_taubin(self, lam=0.5, mu=-0.53, niters=10):
+        '''
+            Compute the membrane surfaces without a Poisson surface:
+                memb_planar triangulates the xy-coordinates of the points, and
+                memb_smooth is the Taubin-smoothed memb_exact
+            this is cheaper than compute_membrane_surface, but assumes that
+                the membrane is a height field over the xy-plane
+        '''
+
+        # 1. triangulate the points projected on the xy-plane
+        self.ppoints = np.copy(self.points[:,:2])
+        self.memb_planar = TriMesh(self.ppoints, periodic=self.periodic, label='memb_planar')
+        self.memb_exact  = TriMesh(self.points,  periodic=self.periodic, label='memb_exact')
+
+        if self.periodic:
+            self.memb_planar.set_bbox(self.bbox[0,:2], self.bbox[1,:2])
+            self.pperiod = self.bbox[1,:2] - self.bbox[0,:2]
+
+            bb0 = self.points.min(axis=0)
+            bb1 = self.points.max(axis=0)
+            bb0[:2] = self.bbox[0,:2]
+            bb1[:2] = self.bbox[1,:2]
+            self.memb_exact.set_bbox(bb0, bb1)
+
+        self.triangulate_planar()
+        self.memb_exact.copy_triangulation(self.memb_planar)
+
+        # 2. smooth the exact surface
+        self.spoints = self.memb_exact.smooth_taubin(lam, mu, niters)
+        self.memb_smooth = TriMesh(self.spoints, periodic=self.periodic, label='memb_smooth')
+
+        if self.periodic:
+            bb0 = self.spoints.min(axis=0)
+            bb1 = self.spoints.max(axis=0)
+            bb0[:2] = self.bbox[0,:2]
+            bb1[:2] = self.bbox[1,:2]
+            self.memb_smooth.set_bbox(bb0, bb1)
+
+        self.memb_smooth.copy_triangulation(self.memb_planar)
+        self.apply_roi()
+        self.release_projections()
+
+    # --------------------------------------------------------------------------
+    def release_projections(self):
+        '''
+            Share the projected points with the vertices of the meshes (which
+                are copies of them), unless all intermediates are retained
+        '''
+        if self.retain == 'all':
+            return
+        self.ppoints = self.memb_planar.vertices
+        self.spoints = self.memb_smooth.vertices
+
     # --------------------------------------------------------------------------
     def compute_properties(self, mtype='smooth'):
 
@@ -231,15 +428,29 @@ class Membrane(object):
             self.memb_smooth.compute_pointareas()
             self.memb_smooth.compute_curvatures()
 
+    # --------------------------------------------------------------------------
+    def compute_tilt(self, tails, mtype='smooth'):
+        '''
+            Compute the tilt of every lipid (head = the given point) with respect to
+                the normal of the membrane surface at its (projected) location
+                tails: ndarray of shape (npoints, 3), paired with the points
+        '''
+        assert mtype == 'smooth' or mtype == 'exact'
+        mesh = self.memb_smooth if mtype == 'smooth' else self.memb_exact
+
+        (angles, directors) = mesh.compute_tilt(self.points, tails)
+        self.properties['tilt_angle'] = angles
+        self.properties['tilt_director'] = directors
+
     # --------------------------------------------------------------------------
     # compute density of points given by plabels
         # on every vertex
-    def compute_density(self, type, sigma, name, get_nlipdis, labels=[]):
+    def compute_density(self, type, sigma, name, get_nlipdis, labels=[], fast_exp=False, tolerance=0., knn=0):
 
         nlabels = len(labels)
 
-        if type < 1 or type > 3:
-            raise InvalidArgument('Invalid density type, {}. Should be 1 (geodesic), 2 (2D) or 3 (3D)'.format(type))
+        if type < 1 or type > 5:
+            raise InvalidArgument('Invalid density type, {}. Should be 1 (geodesic), 2 (2D), 3 (3D), 4 (DTFE) or 5 (diffusion)'.format(type))
 
         # if labels are not available
         if nlabels == 0 and self.labels.shape == (0,0):
@@ -247,7 +458,7 @@ class Membrane(object):
 
         # estimate density of all points
         if nlabels == 0:
-            self.properties[name] = self.memb_smooth.compute_density(type, sigma, name, get_nlipdis, np.empty([0]))
+            self.properties[name] = self.memb_smooth.compute_density(type, sigma, name, get_nlipdis, np.empty([0]), fast_exp, tolerance, knn)
             #print '---------->',  self.properties[name].min(),self.properties[name].max()
             return
 
@@ -257,9 +468,95 @@ class Membrane(object):
             raise ValueError('Cannot compute density of selected labels, because point labels are not available')
 
         lidxs = np.where(np.in1d(self.labels, labels))[0]
-        self.properties[name] = self.memb_smooth.compute_density(type, sigma, name, get_nlipdis, lidxs)
+        self.properties[name] = self.memb_smooth.compute_density(type, sigma, name, get_nlipdis, lidxs, fast_exp, tolerance, knn)
         #print ('----------> {} : {} {}'.format(name, self.properties[name].min(),self.properties[name].max()))
 
+    # --------------------------------------------------------------------------
+    def compute_properties_decomposed(self, tiles=(2,2), densities=[], nprocs=None, cutoff=1e-7):
+        '''
+            Compute normals, point areas, curvatures, and densities of memb_smooth
+            on tiles of the box, using separate worker processes (see decomposition.py)
+                densities: list of (type, sigma, name, get_nlipids, labels), type 1, 2, or 3
+                cutoff:    relative value of the kernel beyond which the sources are
+                           omitted (the size of the halo of every tile; 0: no halo)
+            the normals, point areas, and curvatures match compute_properties(), and
+            the densities match compute_density() up to the cutoff (exactly if 0)
+        '''
+        from .decomposition import compute_properties_decomposed
+
+        mesh = self.memb_smooth
+        if self.periodic:
+            bbox = mesh.bbox.reshape(2,-1)
+            tfaces, dverts, pfaces = mesh.tfaces, mesh.dverts, mesh.pfaces
+        else:
+            bbox = np.array([mesh.vertices.min(axis=0), mesh.vertices.max(axis=0)])
+            tfaces, dverts = np.empty((0,3), dtype=np.uint32), np.empty((0,3), dtype=np.float32)
+            pfaces = None
+
+        dens = []
+        for (type, sigma, name, get_nlipids, labels) in densities:
+            d = {'type': type, 'sigma': sigma, 'name': name, 'get_nlipids': get_nlipids}
+            if len(labels) > 0:
+                if self.labels.shape == (0,0):
+                    raise ValueError('Cannot compute density of selected labels, because point labels are not available')
+                d['pidxs'] = np.where(np.in1d(self.labels, labels))[0]
+            dens.append(d)
+
+        r = compute_properties_decomposed(mesh.vertices, mesh.faces, tfaces, dverts, bbox, self.periodic,
+                                          tiles=tiles, densities=dens, nprocs=nprocs,
+                                          pfaces=pfaces, cutoff=cutoff)
+
+        mesh.pnormals = r['normals']
+        mesh.pareas = r['pareas']
+        mesh.mean_curv = r['mean_curv']
+        mesh.gaus_curv = r['gaus_curv']
+        for d in dens:
+            self.properties[d['name']] = r[d['name']]
+
+    # --------------------------------------------------------------------------
+    @staticmethod
+    def compute_properties_concurrent(membranes, mtypes=('exact', 'smooth'), densities=[], nthreads=0):
+        '''
+            Compute normals, point areas, and curvatures of the given surfaces (mtypes),
+            and densities of memb_smooth, of all membranes as one task graph in the
+            native library (independent tasks run concurrently)
+                densities: list of (type, sigma, name, get_nlipids, labels)
+            the results are the same as compute_properties() and compute_density()
+        '''
+        for mtype in mtypes:
+            assert mtype == 'smooth' or mtype == 'exact'
+
+        LOGGER.info('Computing properties of {} membrane(s) concurrently'.format(len(membranes)))
+        mtimer = Timer()
+
+        tasks = pymemsurfer.MeshTasks()
+        for m in membranes:
+            for mtype in mtypes:
+                mesh = m.memb_smooth if mtype == 'smooth' else m.memb_exact
+                tasks.add_normals(mesh.tmesh)
+                tasks.add_pointareas(mesh.tmesh)
+                tasks.add_curvature(mesh.tmesh)
+
+            for (type, sigma, name, get_nlipids, labels) in densities:
+                pidxs = []
+                if len(labels) > 0:
+                    if m.labels.shape == (0,0):
+                        raise ValueError('Cannot compute density of selected labels, because point labels are not available')
+                    pidxs = np.where(np.in1d(m.labels, labels))[0].tolist()
+                tasks.add_density(m.memb_smooth.tmesh, name, int(type), float(sigma), bool(get_nlipids), pidxs)
+
+        tasks.run(int(nthreads), LOGGER.isEnabledFor(logging.DEBUG))
+
+        # collect the (cached) results
+        for m in membranes:
+            for mtype in mtypes:
+                m.compute_properties(mtype)
+            for (type, sigma, name, get_nlipids, labels) in densities:
+                m.compute_density(type, sigma, name, get_nlipids, labels)
+
+        mtimer.end()
+        LOGGER.info('Computed properties of {} membrane(s)! took {}'.format(len(membranes), mtimer))
+
     # --------------------------------------------------------------------------
     @staticmethod
     def compute_thickness(a, b, mtype='smooth'):
@@ -274,37 +571,117 @@ class Membrane(object):
 
     # --------------------------------------------------------------------------
     @staticmethod
-    def compute_densities(membranes, types, sigmas, get_nlipdis, l):
+    def compute_densities(membranes, types, sigmas, get_nlipdis, l, fast_exp=False, tolerance=0., knn=0):
 
         labels = [] if l == 'all' else [l]
         for t in types:
+
+            # DTFE (type 4) is parameter-free
+            if t == 4:
+                name = 'density_type{0}_{1}'.format(t, l)
+                for m in membranes:
+                    m.compute_density(t, 0., name, get_nlipdis, labels)
+                continue
+
             for s in sigmas:
                 name = 'density_type{0}_{1}_k{2:.1f}'.format(t, l, s)
+                if knn > 0:
+                    name += '_knn{}'.format(knn)
                 for m in membranes:
-                    m.compute_density(t, s, name, get_nlipdis, labels)
+                    m.compute_density(t, s, name, get_nlipdis, labels, fast_exp, tolerance, knn)
 
     # --------------------------------------------------------------------------
     # A static method that computes and returns a membrane object
     # --------------------------------------------------------------------------
     @staticmethod
-    def compute(positions, labels, bbox, periodic):
+    def compute(positions, labels, bbox, periodic, previous=None, reuse_tolerance=0.,
+                roi_centers=None, roi_radius=30., radii=None, retain='all'):
 
         knbrs = 18
 
         # initialize the membrane!
-        m = Membrane(positions, labels=labels, periodic=periodic, bbox=bbox)
+        # (restricted to a region of interest, e.g., around a protein)
+        m = Membrane(positions, labels=labels, periodic=periodic, bbox=bbox, radii=radii,
+                     retain=retain)
+        if roi_centers is not None:
+            m.set_roi(roi_centers, roi_radius)
 
         # compute the membrane
+        # (reusing the Poisson surface of the previous frame, if it barely moved)
         m.fit_points_to_box_xy()
         m.compute_pnormals(knbrs)
-        m.compute_approx_surface()
+        m.compute_approx_surface(previous=previous, reuse_tolerance=reuse_tolerance)
         m.compute_membrane_surface()
 
-        # compute properties on the membrane
-        m.compute_properties('exact')
-        m.compute_properties('smooth')
+        # compute properties on the membrane (exact and smooth concurrently)
+        Membrane.compute_properties_concurrent([m], ('exact', 'smooth'))
         return m
 
+    # --------------------------------------------------------------------------
+    # --------------------------------------------------------------------------
+    def release(self, policy=None):
+        '''
+            Free the intermediates that are no longer needed once all properties
+            have been computed (called by write() and write_all())
+                policy: 'all', 'outputs', or 'minimal' (default: the retain policy)
+                    'all':      keep everything
+                    'outputs':  free the point set, and the native caches (adjacency,
+                                    geodesics, heat solver, operators) and fields of
+                                    the meshes; the numpy arrays and properties are kept
+                    'minimal':  also free the poisson surface (and its reference points),
+                                    memb_planar, memb_exact, and the projected points,
+                                    i.e., keep only the
+                                    points, labels, normals, properties, and memb_smooth
+        '''
+        policy = self.retain if policy is None else policy
+        if policy not in Membrane.RETAIN:
+            raise ValueError('Invalid retention policy ({}). Should be one of {}'.format(policy, Membrane.RETAIN))
+        if policy == 'all':
+            return
+
+        self.pset = None
+        for m in ['surf_poisson', 'memb_planar', 'memb_smooth', 'memb_exact']:
+            if hasattr(self, m):
+                getattr(self, m).release_caches()
+                getattr(self, m).release_fields()
+
+        if policy == 'minimal':
+            for a in ['surf_poisson', 'poisson_ref_points', 'memb_planar', 'memb_exact', 'spoints', 'ppoints']:
+                if hasattr(self, a):
+                    delattr(self, a)
+
+    def memory_usage(self):
+        '''
+            Bytes retained per object (numpy arrays and native objects); the
+                projected points that share the vertices of the meshes are
+                counted only with the meshes
+        '''
+        meshes = [m for m in ['surf_poisson', 'memb_planar', 'memb_smooth', 'memb_exact']
+                  if hasattr(self, m)]
+
+        def nbytes(a):
+            if not isinstance(a, np.ndarray):
+                return 0
+            for m in meshes:
+                if np.may_share_memory(a, getattr(self, m).vertices):
+                    return 0
+            return a.nbytes
+
+        usage = {}
+        for a in ['points', 'pnormals', 'labels', 'spoints', 'ppoints']:
+            usage[a] = nbytes(getattr(self, a, None))
+
+        usage['properties'] = sum(nbytes(np.asarray(v)) for v in self.properties.values())
+        usage['pset'] = 0 if self.pset is None else self.pset.memory_usage()
+
+        for m in meshes:
+            r = getattr(self, m).memory_usage()
+            usage[m] = r['numpy'] + r['native']
+
+        usage['total'] = sum(usage.values())
+        LOGGER.debug('Membrane retains {} bytes ({})'.format(usage['total'], self.retain))
+        return usage
+
     # --------------------------------------------------------------------------
     # --------------------------------------------------------------------------
     def write_all(self, outprefix, params={}):
@@ -316,7 +693,8 @@ class Membrane(object):
             pparams['labels'] = self.labels
 
         write2vtkpolydata(outprefix+'_points.vtp', self.points, pparams)
-        self.surf_poisson.write_vtp(outprefix+'_surface_poisson.vtp')
+        if hasattr(self, 'surf_poisson'):
+            self.surf_poisson.write_vtp(outprefix+'_surface_poisson.vtp')
 
         if self.labels.shape != (0,0):
             params['labels'] = self.labels
@@ -325,9 +703,13 @@ class Membrane(object):
             params[key] = self.properties[key]
 
         #self.memb_exact.faces = self.memb_smooth.faces
-        self.memb_planar.write_vtp(outprefix+'_planar.vtp', params)
-        self.memb_exact.write_vtp(outprefix+'_membrane_exact.vtp', params)
+        # memb_planar and memb_exact are freed by release() with retain='minimal'
+        if hasattr(self, 'memb_planar'):
+            self.memb_planar.write_vtp(outprefix+'_planar.vtp', params)
+        if hasattr(self, 'memb_exact'):
+            self.memb_exact.write_vtp(outprefix+'_membrane_exact.vtp', params)
         self.memb_smooth.write_vtp(outprefix+'_membrane_smooth.vtp', params)
+        self.release()
 
         #self.memb_planar.tmesh.write_binary(outprefix+'_mesh2.bin')
         #self.memb_exact.tmesh.write_binary(outprefix+'_mesh3.bin')
@@ -350,6 +732,7 @@ class Membrane(object):
             params[key] = self.properties[key]
 
         self.memb_smooth.write_vtp(outprefix+'_membrane.vtp', params)
+        self.release()
         #self.memb_smooth.write_off("test.off")
 
     # --------------------------------------------------------------------------
@@ -18,9 +18,14 @@ For details, see https://github.com/LLNL/MemSurfer.
 #define SWIG_FILE_WITH_INIT
 #include "Types.hpp"
 #include "PointSet.hpp"
+#include "SparseMatrix.hpp"
 #include "TriMesh.hpp"
 #include "DensityKernels.hpp"
 #include "DistanceKernels.hpp"
+#include "FieldAccumulator.hpp"
+#include "ContactLifetimes.hpp"
+#include "LateralDiffusion.hpp"
+#include "MeshTasks.hpp"
 %}
 
 %include "stdint.i"
@@ -30,6 +35,7 @@ For details, see https://github.com/LLNL/MemSurfer.
 namespace std {
   %template(FloatVector) vector<float>;
   %template(IntVector) vector<int>;
+  %template(StringVector) vector<string>;
 }
 
 
@@ -41,16 +47,51 @@ import_array();
 
 %apply (float* INPLACE_ARRAY1, int DIM1) {(float *_, int n)};
 %apply (double* INPLACE_ARRAY1, int DIM1) {(double *_, int n)};
+%apply (int* INPLACE_ARRAY1, int DIM1) {(int *_, int n)};
 %apply (float* INPLACE_ARRAY2, int DIM1, int DIM2) {(float *_, int n, int d)};
 %apply (double* INPLACE_ARRAY2, int DIM1, int DIM2) {(double *_, int n, int d)};
 %apply (uint32_t* INPLACE_ARRAY2, int DIM1, int DIM2) {(uint32_t *_, int n, int d)};
 %apply (int32_t* INPLACE_ARRAY2, int DIM1, int DIM2) {(int32_t *_, int n, int d)};
+%apply (float* INPLACE_ARRAY2, int DIM1, int DIM2) {(float *heads, int nh, int dh), (float *tails, int nt, int dt)};
 
 %apply (string key, float* INPLACE_ARRAY2, int DIM1, int DIM2) {(string key, float *_, int n, int d)};
 %apply (string key, double* INPLACE_ARRAY2, int DIM1, int DIM2) {(string key, double *_, int n, int d)};
 
+// the serialization buffers are sized with size_t
+%numpy_typemaps(unsigned char, NPY_UBYTE, size_t)
+%apply (unsigned char* INPLACE_ARRAY1, size_t DIM1) {(uint8_t *_, size_t n)};
+%apply (unsigned char* IN_ARRAY1, size_t DIM1) {(const uint8_t *buffer, size_t nbytes)};
+
+%pythoncode %{
+import numpy
+%}
+
+// pickle the native objects through their binary serialization
+%define PICKLE_SERIALIZED(CLASS)
+%extend CLASS {
+%pythoncode %{
+    def __getstate__(self):
+        buffer = numpy.empty(self.serialized_size(), dtype=numpy.uint8)
+        self.serialize(buffer)
+        return buffer
+
+    def __setstate__(self, state):
+        self.__init__()
+        self.deserialize(numpy.asarray(state, dtype=numpy.uint8))
+%}
+};
+%enddef
+
+PICKLE_SERIALIZED(TriMesh)
+PICKLE_SERIALIZED(PointSet)
+
 %include "Types.hpp"
 %include "PointSet.hpp"
+%include "SparseMatrix.hpp"
 %include "TriMesh.hpp"
 %include "DensityKernels.hpp"
 %include "DistanceKernels.hpp"
+%include "FieldAccumulator.hpp"
+%include "ContactLifetimes.hpp"
+%include "LateralDiffusion.hpp"
+%include "MeshTasks.hpp"
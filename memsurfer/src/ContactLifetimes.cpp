@@ -0,0 +1,259 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "ContactLifetimes.hpp"
+#include "TriMesh.hpp"
+
+/// -----------------------------------------------------------------------------
+//! sort (and remove duplicates from) keys smaller than maxkey
+//!     lsd radix sort on 16-bit digits, i.e., linear in the number of keys
+/// -----------------------------------------------------------------------------
+static void radix_sort_unique(std::vector<uint64_t> &keys, const uint64_t maxkey) {
+
+    std::vector<uint64_t> tmp (keys.size());
+    std::vector<size_t> offsets (1 << 16);
+
+    for(uint8_t shift = 0; shift < 64 && (maxkey >> shift) > 0; shift += 16) {
+
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for(auto iter = keys.begin(); iter != keys.end(); iter++)
+            offsets[(*iter >> shift) & 0xFFFF]++;
+
+        size_t sum = 0;
+        for(auto iter = offsets.begin(); iter != offsets.end(); iter++) {
+            const size_t c = *iter;
+            *iter = sum;
+            sum += c;
+        }
+
+        for(auto iter = keys.begin(); iter != keys.end(); iter++)
+            tmp[offsets[(*iter >> shift) & 0xFFFF]++] = *iter;
+        keys.swap(tmp);
+    }
+
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+ContactLifetimes::ContactLifetimes(int *_, int n, int nbins) {
+
+    if (n <= 0 || nbins <= 0) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "(): Need the species of every lipid, and nbins > 0!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    int nspecies = 0;
+    for(int i = 0; i < n; i++) {
+        if (_[i] < 0) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "(): Invalid species (" << _[i] << ") of lipid " << i << "!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+        nspecies = std::max(nspecies, _[i]+1);
+    }
+
+    mSpecies.assign(_, _+n);
+    mNSpecies = nspecies;
+    mNBins = nbins;
+    this->clear();
+}
+
+void ContactLifetimes::clear() {
+
+    mNFrames = 0;
+    mKeys.clear();
+    mStart.clear();
+    mHistogram.assign(size_t(npairs())*mNBins, 0);
+    mCensored.assign(npairs(), 0);
+    mFormed.assign(npairs(), 0);
+    mBroken.assign(npairs(), 0);
+}
+
+uint32_t ContactLifetimes::pair_index(int a, int b) const {
+
+    if (a < 0 || b < 0 || a >= int(mNSpecies) || b >= int(mNSpecies)) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::pair_index(): Invalid species pair (" << a << ", " << b
+               << "); there are " << mNSpecies << " species!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (a > b)
+        std::swap(a, b);
+
+    // row a of the upper triangle starts after a*S - a(a-1)/2 entries
+    return a*mNSpecies - (a*(a-1))/2 + (b-a);
+}
+
+//! the species pair of a contact (key = i*nlipids + j, with i < j)
+uint32_t ContactLifetimes::pair(const uint64_t key) const {
+    const uint64_t n = mSpecies.size();
+    return pair_index(mSpecies[key / n], mSpecies[key % n]);
+}
+
+/// -----------------------------------------------------------------------------
+//! the edges of the planar mesh (including the periodic faces) as sorted keys
+/// -----------------------------------------------------------------------------
+void ContactLifetimes::contacts(const TriMesh &planar, const int *ids, std::vector<uint64_t> &keys) const {
+
+    const uint64_t n = mSpecies.size();
+
+    std::vector<const std::vector<Face>*> faces (1, &planar.mFaces);
+    if (planar.mPeriodic)
+        faces.push_back(&planar.mPeriodicFaces);
+
+    size_t nfaces = 0;
+    for(auto fiter = faces.begin(); fiter != faces.end(); fiter++)
+        nfaces += (*fiter)->size();
+
+    // every interior edge is seen from both of its faces
+    keys.clear();
+    keys.reserve(3*nfaces);
+    for(auto fiter = faces.begin(); fiter != faces.end(); fiter++) {
+    for(auto iter = (*fiter)->begin(); iter != (*fiter)->end(); iter++) {
+
+        const Face &f = *iter;
+        for(uint8_t k = 0; k < 3; k++) {
+
+            uint64_t a = f[k], b = f[(k+1)%3];
+            if (ids) {
+                a = ids[a];
+                b = ids[b];
+            }
+            if (a == b)
+                continue;
+            if (a > b)
+                std::swap(a, b);
+            keys.push_back(a*n + b);
+        }
+    }}
+
+    radix_sort_unique(keys, n*n);
+}
+
+/// -----------------------------------------------------------------------------
+//! diff the contacts of this frame against those of the previous frame
+/// -----------------------------------------------------------------------------
+void ContactLifetimes::add_frame(const TriMesh &planar, int *_, int n, bool verbose) {
+
+    const size_t nverts = planar.mVertices.size();
+    const int *ids = (n > 0) ? _ : 0;
+
+    if (ids == 0 && nverts > mSpecies.size()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::add_frame(): planar mesh has " << nverts
+               << " vertices, but there are " << mSpecies.size() << " lipids! give the lipid ids of the vertices\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (ids) {
+        if (size_t(n) != nverts) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::add_frame(): expected " << nverts << " ids, got " << n << "!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+        for(int i = 0; i < n; i++) {
+            if (ids[i] < 0 || size_t(ids[i]) >= mSpecies.size()) {
+                std::ostringstream errMsg;
+                errMsg << " " << this->tag() << "::add_frame(): Invalid lipid id (" << ids[i] << ") of vertex " << i << "!\n";
+                throw std::invalid_argument(errMsg.str());
+            }
+        }
+    }
+
+    if (verbose) {
+        std::cout << "   > " << this->tag() << "::add_frame(" << mNFrames << ")...";
+        fflush(stdout);
+    }
+
+    std::vector<uint64_t> keys;
+    this->contacts(planar, ids, keys);
+
+    // merge the two sorted lists
+    const uint32_t frame = mNFrames;
+    const size_t nprev = mKeys.size(), ncurr = keys.size();
+
+    std::vector<uint32_t> start (ncurr);
+    size_t nformed = 0, nbroken = 0;
+
+    size_t i = 0, j = 0;
+    while (i < nprev || j < ncurr) {
+
+        // continued
+        if (i < nprev && j < ncurr && mKeys[i] == keys[j]) {
+            start[j++] = mStart[i++];
+        }
+
+        // ended (it was present in frames start to frame-1)
+        else if (j == ncurr || (i < nprev && mKeys[i] < keys[j])) {
+
+            const uint32_t p = pair(mKeys[i]);
+            if (mStart[i] == 0) {
+                mCensored[p]++;
+            }
+            else {
+                const uint32_t life = std::min(frame - mStart[i], mNBins);
+                mHistogram[size_t(p)*mNBins + life-1]++;
+            }
+            mBroken[p]++;
+            nbroken++;
+            i++;
+        }
+
+        // began (the contacts of the first frame did not form here)
+        else {
+            if (frame > 0) {
+                mFormed[pair(keys[j])]++;
+                nformed++;
+            }
+            start[j++] = frame;
+        }
+    }
+
+    mKeys.swap(keys);
+    mStart.swap(start);
+    mNFrames++;
+
+    if (verbose) {
+        std::cout << " Done! " << ncurr << " contacts (" << nformed << " formed, " << nbroken << " broken)\n";
+    }
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+std::vector<TypeIndexI> ContactLifetimes::histogram(int a, int b) const {
+
+    const size_t p = pair_index(a, b);
+    return std::vector<TypeIndexI>(mHistogram.begin() + p*mNBins, mHistogram.begin() + (p+1)*mNBins);
+}
+
+std::vector<TypeIndexI> ContactLifetimes::active(int a, int b) const {
+
+    const uint32_t p = pair_index(a, b);
+
+    std::vector<TypeIndexI> ages;
+    for(size_t i = 0; i < mKeys.size(); i++) {
+        if (pair(mKeys[i]) == p)
+            ages.push_back(mNFrames - mStart[i]);
+    }
+    return ages;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
@@ -0,0 +1,405 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "FieldAccumulator.hpp"
+#include "TriMesh.hpp"
+
+//! checkpoint file format
+static const char FA_MAGIC[4] = {'M','S','F','A'};
+static const uint32_t FA_VERSION = 1;
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+FieldAccumulator::FieldAccumulator(float *_, int n, int nx, int ny) {
+
+    if (n != 4 || nx <= 0 || ny <= 0 || !(_[2] > _[0]) || !(_[3] > _[1])) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "(): Invalid reference grid! expected bbox [x0,y0,x1,y1] and nx, ny > 0\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    mBox0 = Vertex(_[0], _[1], 0);
+    mBox1 = Vertex(_[2], _[3], 0);
+    mNx = nx;
+    mNy = ny;
+}
+
+const FieldAccumulator::Stats&
+FieldAccumulator::stats(const std::string &name) const {
+
+    auto iter = mStats.find(name);
+    if (iter == mStats.end()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::stats(): field (" << name << ") has not been accumulated!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    return iter->second;
+}
+
+std::vector<std::string> FieldAccumulator::names() const {
+
+    std::vector<std::string> n;
+    for(auto iter = mStats.begin(); iter != mStats.end(); iter++)
+        n.push_back(iter->first);
+    std::sort(n.begin(), n.end());
+    return n;
+}
+
+/// -----------------------------------------------------------------------------
+//! locate the grid samples in the triangles of the planar mesh
+/// -----------------------------------------------------------------------------
+void FieldAccumulator::rasterize(const TriMesh &planar, std::vector<Sample> &samples, std::vector<bool> &valid) const {
+
+    const size_t nsamples = size_t(mNx)*mNy;
+    samples.resize(nsamples);
+    valid.assign(nsamples, false);
+
+    // map planar vertices to (continuous) grid coordinates, where sample (i,j) is at (i,j)
+    const bool periodic = planar.mPeriodic && planar.bbox_valid;
+
+    const Vertex b0 = periodic ? planar.mBox0 : mBox0;
+    const Vertex bw = periodic ? (planar.mBox1 - planar.mBox0) : (mBox1 - mBox0);
+
+    const size_t nverts = planar.mVertices.size();
+    std::vector<TypeFunction> gx (nverts), gy (nverts);
+    for(size_t i = 0; i < nverts; i++) {
+        gx[i] = (planar.mVertices[i][0] - b0[0]) / bw[0] * TypeFunction(mNx) - 0.5;
+        gy[i] = (planar.mVertices[i][1] - b0[1]) / bw[1] * TypeFunction(mNy) - 0.5;
+    }
+
+    // faces that go across the domain are unwrapped with respect to their first vertex
+    std::vector<const std::vector<Face>*> faces (1, &planar.mFaces);
+    if (periodic)
+        faces.push_back(&planar.mPeriodicFaces);
+
+    const TypeFunction eps = 1e-5;
+    const int nx = mNx, ny = mNy;
+
+    for(auto fiter = faces.begin(); fiter != faces.end(); fiter++) {
+    for(auto iter = (*fiter)->begin(); iter != (*fiter)->end(); iter++) {
+
+        const Face &f = *iter;
+
+        TypeFunction x[3], y[3];
+        for(uint8_t d = 0; d < 3; d++) {
+            x[d] = gx[f[d]];
+            y[d] = gy[f[d]];
+            if (periodic && d > 0) {
+                if (x[d] - x[0] >  0.5*nx)    x[d] -= nx;
+                if (x[d] - x[0] < -0.5*nx)    x[d] += nx;
+                if (y[d] - y[0] >  0.5*ny)    y[d] -= ny;
+                if (y[d] - y[0] < -0.5*ny)    y[d] += ny;
+            }
+        }
+
+        const TypeFunction det = (y[1]-y[2])*(x[0]-x[2]) + (x[2]-x[1])*(y[0]-y[2]);
+        if (std::fabs(det) < 1e-12)
+            continue;
+
+        const int i0 = int(std::ceil(std::min(x[0], std::min(x[1], x[2])) - eps));
+        const int i1 = int(std::floor(std::max(x[0], std::max(x[1], x[2])) + eps));
+        const int j0 = int(std::ceil(std::min(y[0], std::min(y[1], y[2])) - eps));
+        const int j1 = int(std::floor(std::max(y[0], std::max(y[1], y[2])) + eps));
+
+        for(int j = j0; j <= j1; j++) {
+        for(int i = i0; i <= i1; i++) {
+
+            int wi = i, wj = j;
+            if (periodic) {
+                wi = ((i % nx) + nx) % nx;
+                wj = ((j % ny) + ny) % ny;
+            }
+            else if (i < 0 || j < 0 || i >= nx || j >= ny) {
+                continue;
+            }
+
+            // shared edges: the first triangle wins
+            const size_t sidx = size_t(wj)*nx + wi;
+            if (valid[sidx])
+                continue;
+
+            const TypeFunction w0 = ((y[1]-y[2])*(i-x[2]) + (x[2]-x[1])*(j-y[2])) / det;
+            const TypeFunction w1 = ((y[2]-y[0])*(i-x[2]) + (x[0]-x[2])*(j-y[2])) / det;
+            const TypeFunction w2 = 1.0 - w0 - w1;
+            if (w0 < -eps || w1 < -eps || w2 < -eps)
+                continue;
+
+            Sample &s = samples[sidx];
+            s.v[0] = f[0];  s.v[1] = f[1];  s.v[2] = f[2];
+            s.w[0] = w0;    s.w[1] = w1;    s.w[2] = w2;
+            valid[sidx] = true;
+        }}
+    }}
+}
+
+/// -----------------------------------------------------------------------------
+//! Welford's update of the running mean and variance
+/// -----------------------------------------------------------------------------
+void FieldAccumulator::add(Stats &stats, const std::vector<TypeFunction> &values, const std::vector<bool> &valid) {
+
+    const size_t nsamples = size_t(mNx)*mNy;
+    if (stats.count.empty()) {
+        stats.nframes = 0;
+        stats.count.assign(nsamples, 0);
+        stats.mean.assign(nsamples, 0);
+        stats.m2.assign(nsamples, 0);
+    }
+
+    #pragma omp parallel for
+    for(TypeIndexI i = 0; i < TypeIndexI(nsamples); i++) {
+
+        if (!valid[i] || std::isnan(values[i]))
+            continue;
+
+        const double x = values[i];
+        const double delta = x - stats.mean[i];
+        stats.count[i]++;
+        stats.mean[i] += delta / double(stats.count[i]);
+        stats.m2[i] += delta * (x - stats.mean[i]);
+    }
+    stats.nframes++;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+void FieldAccumulator::accumulate(const TriMesh &planar, const TriMesh &mesh,
+                                  const std::vector<std::string> &names, bool verbose) {
+
+    const size_t nverts = planar.mVertices.size();
+    if (mesh.mVertices.size() != nverts) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::accumulate(): planar mesh has " << nverts
+               << " vertices, but mesh has " << mesh.mVertices.size() << "!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    for(auto iter = names.begin(); iter != names.end(); iter++) {
+        auto fiter = mesh.mFields.find(*iter);
+        if (fiter == mesh.mFields.end() || fiter->second.size() != nverts) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::accumulate(): mesh does not have a vertex field (" << *iter << ")!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+    }
+
+    if (verbose) {
+        std::cout << "   > " << this->tag() << "::accumulate(<" << names.size() << "> fields on "
+                  << mNx << " x " << mNy << ")...";
+        fflush(stdout);
+    }
+
+    // the geometry is located once for all fields
+    std::vector<Sample> samples;
+    std::vector<bool> valid;
+    this->rasterize(planar, samples, valid);
+
+    const size_t nsamples = samples.size();
+    std::vector<TypeFunction> values (nsamples);
+
+    for(auto iter = names.begin(); iter != names.end(); iter++) {
+
+        const std::vector<TypeFunction> &field = mesh.mFields.at(*iter);
+
+        #pragma omp parallel for
+        for(TypeIndexI i = 0; i < TypeIndexI(nsamples); i++) {
+            if (!valid[i])
+                continue;
+            const Sample &s = samples[i];
+            values[i] = s.w[0]*field[s.v[0]] + s.w[1]*field[s.v[1]] + s.w[2]*field[s.v[2]];
+        }
+        this->add(mStats[*iter], values, valid);
+    }
+
+    if (verbose) {
+        std::cout << " Done! " << std::count(valid.begin(), valid.end(), true) << " of "
+                  << nsamples << " samples covered!\n";
+    }
+}
+
+void FieldAccumulator::accumulate_grid(const std::string &name, float *_, int n) {
+
+    const size_t nsamples = size_t(mNx)*mNy;
+    if (size_t(n) != nsamples) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::accumulate_grid(): expected " << nsamples << " values, got " << n << "!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    const std::vector<TypeFunction> values (_, _+n);
+    this->add(mStats[name], values, std::vector<bool>(nsamples, true));
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+std::vector<TypeFunction> FieldAccumulator::mean(const std::string &name) const {
+
+    const Stats &s = stats(name);
+    std::vector<TypeFunction> m (s.mean.size(), std::numeric_limits<TypeFunction>::quiet_NaN());
+    for(size_t i = 0; i < m.size(); i++) {
+        if (s.count[i] > 0)
+            m[i] = s.mean[i];
+    }
+    return m;
+}
+
+std::vector<TypeFunction> FieldAccumulator::variance(const std::string &name) const {
+
+    // unbiased estimate (0 for a single frame)
+    const Stats &s = stats(name);
+    std::vector<TypeFunction> v (s.m2.size(), std::numeric_limits<TypeFunction>::quiet_NaN());
+    for(size_t i = 0; i < v.size(); i++) {
+        if (s.count[i] > 1)         v[i] = s.m2[i] / double(s.count[i]-1);
+        else if (s.count[i] == 1)   v[i] = 0;
+    }
+    return v;
+}
+
+std::vector<TypeIndexI> FieldAccumulator::count(const std::string &name) const {
+    const Stats &s = stats(name);
+    return std::vector<TypeIndexI>(s.count.begin(), s.count.end());
+}
+
+/// -----------------------------------------------------------------------------
+//! checkpointing (binary)
+//!     magic, version, bbox, nx, ny, nfields,
+//!     per field: name, nframes, count[nx*ny], mean[nx*ny], m2[nx*ny]
+/// -----------------------------------------------------------------------------
+bool FieldAccumulator::save(const std::string &filename, bool verbose) const {
+
+    if (verbose){
+        std::cout << " " << this->tag() << "::save(" << filename << ")...";
+        fflush(stdout);
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << " " << this->tag() << "::save(): could not open (" << filename << ")!\n";
+        return false;
+    }
+
+    const size_t nsamples = size_t(mNx)*mNy;
+    const uint32_t nfields = mStats.size();
+    const float bbox[4] = {mBox0[0], mBox0[1], mBox1[0], mBox1[1]};
+
+    file.write(FA_MAGIC, 4);
+    file.write((const char*) &FA_VERSION, sizeof(uint32_t));
+    file.write((const char*) bbox, 4*sizeof(float));
+    file.write((const char*) &mNx, sizeof(uint32_t));
+    file.write((const char*) &mNy, sizeof(uint32_t));
+    file.write((const char*) &nfields, sizeof(uint32_t));
+
+    for(auto iter = mStats.begin(); iter != mStats.end(); iter++) {
+
+        const uint32_t len = iter->first.size();
+        const Stats &s = iter->second;
+
+        file.write((const char*) &len, sizeof(uint32_t));
+        file.write(iter->first.data(), len);
+        file.write((const char*) &s.nframes, sizeof(uint64_t));
+        file.write((const char*) s.count.data(), nsamples*sizeof(uint32_t));
+        file.write((const char*) s.mean.data(), nsamples*sizeof(double));
+        file.write((const char*) s.m2.data(), nsamples*sizeof(double));
+    }
+
+    if (!file.good()) {
+        std::cerr << " " << this->tag() << "::save(): failed to write (" << filename << ")!\n";
+        return false;
+    }
+
+    if (verbose) {
+        std::cout << " Done! Wrote " << nfields << " fields!\n";
+    }
+    return true;
+}
+
+bool FieldAccumulator::load(const std::string &filename, bool verbose) {
+
+    if (verbose){
+        std::cout << " " << this->tag() << "::load(" << filename << ")...";
+        fflush(stdout);
+    }
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << " " << this->tag() << "::load(): could not open (" << filename << ")!\n";
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version, nx, ny, nfields;
+    float bbox[4];
+
+    file.read(magic, 4);
+    file.read((char*) &version, sizeof(uint32_t));
+    file.read((char*) bbox, 4*sizeof(float));
+    file.read((char*) &nx, sizeof(uint32_t));
+    file.read((char*) &ny, sizeof(uint32_t));
+    file.read((char*) &nfields, sizeof(uint32_t));
+
+    if (!file.good() || std::string(magic, 4) != std::string(FA_MAGIC, 4) || version != FA_VERSION) {
+        std::cerr << " " << this->tag() << "::load(): (" << filename << ") is not a valid checkpoint!\n";
+        return false;
+    }
+
+    // the checkpoint must be on the same reference grid
+    if (nx != mNx || ny != mNy ||
+        bbox[0] != mBox0[0] || bbox[1] != mBox0[1] || bbox[2] != mBox1[0] || bbox[3] != mBox1[1]) {
+        std::cerr << " " << this->tag() << "::load(): (" << filename << ") has a different reference grid!\n";
+        return false;
+    }
+
+    const size_t nsamples = size_t(mNx)*mNy;
+    std::unordered_map<std::string, Stats> stats;
+
+    for(uint32_t f = 0; f < nfields; f++) {
+
+        uint32_t len;
+        file.read((char*) &len, sizeof(uint32_t));
+        if (!file.good())
+            break;
+
+        std::string name (len, ' ');
+        file.read(&name[0], len);
+
+        Stats &s = stats[name];
+        s.count.resize(nsamples);
+        s.mean.resize(nsamples);
+        s.m2.resize(nsamples);
+
+        file.read((char*) &s.nframes, sizeof(uint64_t));
+        file.read((char*) s.count.data(), nsamples*sizeof(uint32_t));
+        file.read((char*) s.mean.data(), nsamples*sizeof(double));
+        file.read((char*) s.m2.data(), nsamples*sizeof(double));
+    }
+
+    if (!file.good()) {
+        std::cerr << " " << this->tag() << "::load(): (" << filename << ") is truncated!\n";
+        return false;
+    }
+
+    mStats.swap(stats);
+    if (verbose) {
+        std::cout << " Done! Read " << nfields << " fields!\n";
+    }
+    return true;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
@@ -0,0 +1,456 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <map>
+#include <deque>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <condition_variable>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "InSitu.h"
+#include "Numa.hpp"
+#include "TriMesh.hpp"
+#include "MeshTasks.hpp"
+
+/// -----------------------------------------------------------------------------
+//! a frame queued for analysis (only the selected beads)
+/// -----------------------------------------------------------------------------
+struct ms_frame {
+    long step;
+    Vertex box;
+    std::vector<float> points;
+};
+
+//! the results of a frame
+struct ms_result {
+    bool done;
+    std::string error;
+    std::vector<float> values;
+    ms_result() : done(false) {}
+};
+
+//! a density to compute
+struct ms_density {
+    float sigma;
+    int label;
+};
+
+/// -----------------------------------------------------------------------------
+//! the persistent analysis context
+/// -----------------------------------------------------------------------------
+struct ms_context {
+
+    // configuration (fixed after the first push)
+    bool periodic;
+    int natoms;
+    Vertex box;
+    std::vector<int> selected;
+    std::vector<int> labels;
+    std::vector<ms_density> densities;
+    int niters;
+    float lambda, mu;
+    std::string prefix;
+    int nthreads;
+    size_t max_pending;
+    bool started;
+
+    // the last error (host thread only)
+    std::string error;
+
+    // work queue and results (shared with the workers)
+    std::mutex mutex;
+    std::condition_variable cv_work, cv_done;
+    std::deque<ms_frame> queue;
+    std::map<long, ms_result> results;
+    bool stop;
+
+    std::vector<std::thread> workers;
+
+    int fail(const std::string &msg) {
+        error = msg;
+        return -1;
+    }
+};
+
+/// -----------------------------------------------------------------------------
+//! analyze one frame
+/// -----------------------------------------------------------------------------
+
+static void ms_analyze(const ms_context &ctx, const ms_frame &frame, std::vector<float> &values) {
+
+    const size_t n = frame.points.size() / 3;
+    const size_t nvalues = MS_DENSITY + ctx.densities.size();
+
+    // -------------------------------------------------------------------------
+    // triangulate the xy-positions
+    std::vector<float> xy (2*n);
+    for(size_t i = 0; i < n; i++) {
+        xy[2*i]   = frame.points[3*i];
+        xy[2*i+1] = frame.points[3*i+1];
+    }
+
+    TriMesh planar (xy.data(), int(n), 2);
+    if (ctx.periodic) {
+        float bb[4] = {0, 0, frame.box[0], frame.box[1]};
+        planar.set_periodic();
+        planar.set_bbox(bb, 4);
+    }
+    planar.delaunay();
+
+    // -------------------------------------------------------------------------
+    // the exact and smooth surfaces (bbox is the box in xy, and the points in z)
+    auto set_box = [&ctx, &frame](TriMesh &mesh, const std::vector<float> &points) {
+        if (!ctx.periodic)
+            return;
+        float zmin = points[2], zmax = points[2];
+        for(size_t i = 0; i < points.size(); i += 3) {
+            zmin = std::min(zmin, points[i+2]);
+            zmax = std::max(zmax, points[i+2]);
+        }
+        float bb[6] = {0, 0, zmin, frame.box[0], frame.box[1], zmax};
+        mesh.set_periodic();
+        mesh.set_bbox(bb, 6);
+    };
+    auto set_faces = [&ctx, &planar](TriMesh &mesh) {
+        if (ctx.periodic)   mesh.copy_periodicDelaunay(planar);
+        else                mesh.set_faces(planar);
+    };
+
+    std::vector<float> points (frame.points);
+    TriMesh exact (points.data(), int(n), 3);
+    set_box(exact, points);
+    set_faces(exact);
+
+    if (ctx.niters > 0) {
+        std::vector<float> spoints = exact.smooth_taubin(ctx.lambda, ctx.mu, ctx.niters);
+        exact.update_vertices(spoints.data(), int(n), 3);
+        set_box(exact, spoints);
+    }
+    TriMesh &surface = exact;
+
+    // -------------------------------------------------------------------------
+    // per-lipid properties (the independent ones are computed concurrently)
+    MeshTasks tasks;
+    tasks.add_normals(surface);
+    tasks.add_pointareas(surface);
+#ifdef VTK_AVAILABLE
+    tasks.add_curvature(surface);
+#endif
+
+    // densities of the labeled lipids
+    std::vector<std::string> dnames (ctx.densities.size());
+    for(size_t d = 0; d < ctx.densities.size(); d++) {
+
+        const ms_density &density = ctx.densities[d];
+
+        std::vector<TypeIndexI> ids;
+        if (density.label >= 0) {
+            for(size_t i = 0; i < n; i++) {
+                if (ctx.labels[i] == density.label)
+                    ids.push_back(TypeIndexI(i));
+            }
+            if (ids.empty())
+                continue;
+        }
+
+        std::ostringstream name;
+        name << "density_" << d;
+        dnames[d] = name.str();
+        tasks.add_density(surface, dnames[d], 2, density.sigma, true, ids);
+    }
+    tasks.run(ctx.nthreads);
+
+    // the cached results
+    values.assign(n*nvalues, 0);
+
+    const std::vector<TypeFunction> normals = surface.need_normals();
+    const std::vector<TypeFunction> &areas = surface.need_pointareas();
+#ifdef VTK_AVAILABLE
+    const std::vector<TypeFunction> curvatures = surface.need_curvature();
+#else
+    const std::vector<TypeFunction> curvatures (2*n, NAN);
+#endif
+
+    for(size_t i = 0; i < n; i++) {
+        float *v = &values[i*nvalues];
+        v[MS_AREA] = areas[i];
+        v[MS_CURV_MEAN] = curvatures[i];
+        v[MS_CURV_GAUSS] = curvatures[n+i];
+        v[MS_NORMAL_X] = normals[3*i];
+        v[MS_NORMAL_Y] = normals[3*i+1];
+        v[MS_NORMAL_Z] = normals[3*i+2];
+    }
+
+    for(size_t d = 0; d < ctx.densities.size(); d++) {
+        if (dnames[d].empty())
+            continue;
+        const std::vector<TypeFunction> &field = surface.get_field(dnames[d]);
+        for(size_t i = 0; i < n; i++) {
+            values[i*nvalues + MS_DENSITY + d] = field[i];
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    if (!ctx.prefix.empty()) {
+        std::ostringstream fname;
+        fname << ctx.prefix << "_" << frame.step << ".vtp";
+        surface.write_vtp(fname.str());
+    }
+}
+
+/// -----------------------------------------------------------------------------
+//! worker thread
+/// -----------------------------------------------------------------------------
+
+static void ms_worker(ms_context *ctx) {
+
+#ifdef _OPENMP
+    omp_set_num_threads(ctx->nthreads);
+#endif
+
+    while (true) {
+
+        std::unique_lock<std::mutex> lock(ctx->mutex);
+        ctx->cv_work.wait(lock, [ctx]{ return ctx->stop || !ctx->queue.empty(); });
+        if (ctx->queue.empty())
+            return;
+
+        ms_frame frame = std::move(ctx->queue.front());
+        ctx->queue.pop_front();
+        ctx->cv_work.notify_all();      // room in the queue
+        lock.unlock();
+
+        ms_result result;
+        try {
+            ms_analyze(*ctx, frame, result.values);
+        }
+        catch (const std::exception &e) {
+            result.error = e.what();
+        }
+        result.done = true;
+
+        lock.lock();
+        ctx->results[frame.step] = std::move(result);
+        ctx->cv_done.notify_all();
+    }
+}
+
+/// -----------------------------------------------------------------------------
+//! C API
+/// -----------------------------------------------------------------------------
+
+ms_context* ms_create(int periodic, const float *box, int natoms,
+                      int nselected, const int *selected, const int *labels,
+                      int nworkers, int nthreads) {
+
+    if ((periodic && box == nullptr) || natoms <= 0 || nselected < 3 || selected == nullptr || nworkers < 1) {
+        std::cerr << " ERROR: ms_create(): invalid arguments!\n";
+        return nullptr;
+    }
+    for(int i = 0; i < nselected; i++) {
+        if (selected[i] < 0 || selected[i] >= natoms) {
+            std::cerr << " ERROR: ms_create(): invalid selected index " << selected[i] << " (natoms = " << natoms << ")!\n";
+            return nullptr;
+        }
+    }
+
+    ms_context *ctx = new ms_context();
+    ctx->periodic = bool(periodic);
+    ctx->natoms = natoms;
+    ctx->box = box ? Vertex(box[0], box[1], box[2]) : Vertex(0,0,0);
+    ctx->selected.assign(selected, selected+nselected);
+    if (labels)     ctx->labels.assign(labels, labels+nselected);
+    else            ctx->labels.assign(nselected, 0);
+    ctx->niters = 10;
+    ctx->lambda = 0.5;
+    ctx->mu = -0.53;
+    ctx->nthreads = std::max(nthreads, 1);
+    ctx->max_pending = 2*size_t(nworkers);
+    ctx->started = false;
+    ctx->stop = false;
+
+    for(int i = 0; i < nworkers; i++) {
+        ctx->workers.push_back(std::thread(ms_worker, ctx));
+    }
+    return ctx;
+}
+
+void ms_destroy(ms_context *ctx) {
+
+    if (ctx == nullptr)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        ctx->stop = true;
+    }
+    ctx->cv_work.notify_all();
+    for(auto iter = ctx->workers.begin(); iter != ctx->workers.end(); ++iter) {
+        iter->join();
+    }
+
+    // the results that were not retrieved
+    ctx->results.clear();
+    delete ctx;
+}
+
+const char* ms_last_error(const ms_context *ctx) {
+    return ctx ? ctx->error.c_str() : "invalid context";
+}
+
+/// -----------------------------------------------------------------------------
+int ms_add_density(ms_context *ctx, float sigma, int label) {
+
+    if (ctx == nullptr)     return -1;
+    if (ctx->started)       return ctx->fail("ms_add_density(): cannot configure after the first ms_push()");
+    if (sigma <= 0)         return ctx->fail("ms_add_density(): sigma should be positive");
+
+    ms_density density = {sigma, label};
+    ctx->densities.push_back(density);
+    return int(MS_DENSITY + ctx->densities.size() - 1);
+}
+
+int ms_set_smoothing(ms_context *ctx, int niters, float lambda, float mu) {
+
+    if (ctx == nullptr)     return -1;
+    if (ctx->started)       return ctx->fail("ms_set_smoothing(): cannot configure after the first ms_push()");
+    if (niters < 0 || (niters > 0 && (lambda <= 0 || mu >= 0)))
+        return ctx->fail("ms_set_smoothing(): need niters >= 0, lambda > 0, and mu < 0");
+
+    ctx->niters = niters;
+    ctx->lambda = lambda;
+    ctx->mu = mu;
+    return 0;
+}
+
+int ms_set_output(ms_context *ctx, const char *prefix) {
+
+    if (ctx == nullptr)     return -1;
+    if (ctx->started)       return ctx->fail("ms_set_output(): cannot configure after the first ms_push()");
+
+    ctx->prefix = prefix ? std::string(prefix) : std::string();
+    return 0;
+}
+
+int ms_nvalues(const ms_context *ctx) {
+    return ctx ? int(MS_DENSITY + ctx->densities.size()) : -1;
+}
+
+void ms_set_numa(int first_touch, int huge_pages) {
+    Numa::set_first_touch(first_touch != 0);
+    Numa::set_huge_pages(huge_pages != 0);
+}
+
+/// -----------------------------------------------------------------------------
+int ms_push(ms_context *ctx, long step, const float *coords, const float *box) {
+
+    if (ctx == nullptr)     return -1;
+    if (coords == nullptr)  return ctx->fail("ms_push(): coords is NULL");
+
+    if (box != nullptr) {
+        ctx->box = Vertex(box[0], box[1], box[2]);
+    }
+    if (ctx->periodic && (ctx->box[0] <= 0 || ctx->box[1] <= 0)) {
+        return ctx->fail("ms_push(): invalid periodic box");
+    }
+
+    // gather the selected beads (wrapped into the box in xy)
+    ms_frame frame;
+    frame.step = step;
+    frame.box = ctx->box;
+
+    const size_t n = ctx->selected.size();
+    frame.points.resize(3*n);
+    for(size_t i = 0; i < n; i++) {
+        const float *p = coords + 3*size_t(ctx->selected[i]);
+        float *q = &frame.points[3*i];
+        q[0] = p[0];    q[1] = p[1];    q[2] = p[2];
+        if (ctx->periodic) {
+            for(uint8_t d = 0; d < 2; d++) {
+                q[d] -= ctx->box[d] * std::floor(q[d] / ctx->box[d]);
+                if (q[d] >= ctx->box[d])    q[d] = 0;
+            }
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    if (ctx->results.find(step) != ctx->results.end()) {
+        return ctx->fail("ms_push(): step was already pushed");
+    }
+    ctx->cv_work.wait(lock, [ctx]{ return ctx->queue.size() < ctx->max_pending; });
+
+    ctx->started = true;
+    ctx->results[step] = ms_result();
+    ctx->queue.push_back(std::move(frame));
+    ctx->cv_work.notify_all();
+    return 0;
+}
+
+int ms_wait(ms_context *ctx, long step) {
+
+    if (ctx == nullptr)     return -1;
+
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    if (step >= 0 && ctx->results.find(step) == ctx->results.end()) {
+        return ctx->fail("ms_wait(): unknown step");
+    }
+    ctx->cv_done.wait(lock, [ctx, step]{
+        if (step >= 0)
+            return ctx->results[step].done;
+        for(auto iter = ctx->results.begin(); iter != ctx->results.end(); ++iter) {
+            if (!iter->second.done)
+                return false;
+        }
+        return true;
+    });
+    return 0;
+}
+
+int ms_get_results(ms_context *ctx, long step, float *out, int nout) {
+
+    if (ctx == nullptr)     return -1;
+
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    auto iter = ctx->results.find(step);
+    if (iter == ctx->results.end())     return ctx->fail("ms_get_results(): unknown step");
+    if (!iter->second.done)             return ctx->fail("ms_get_results(): step is not done");
+
+    if (!iter->second.error.empty()) {
+        const std::string msg = "ms_get_results(): " + iter->second.error;
+        ctx->results.erase(iter);
+        return ctx->fail(msg);
+    }
+
+    const std::vector<float> &values = iter->second.values;
+    if (out == nullptr || nout < 0 || size_t(nout) < values.size()) {
+        return ctx->fail("ms_get_results(): output buffer is too small");
+    }
+
+    std::copy(values.begin(), values.end(), out);
+    ctx->results.erase(iter);
+    return 0;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
@@ -0,0 +1,248 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <complex>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+#include <unsupported/Eigen/FFT>
+
+#include "LateralDiffusion.hpp"
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+LateralDiffusion::LateralDiffusion(int *_, int n) {
+
+    if (n <= 0) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "(): Need the species of every lipid!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    int nspecies = 0;
+    for(int i = 0; i < n; i++) {
+        if (_[i] < 0) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "(): Invalid species (" << _[i] << ") of lipid " << i << "!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+        nspecies = std::max(nspecies, _[i]+1);
+    }
+
+    mSpecies.assign(_, _+n);
+    mNSpecies = nspecies;
+    this->clear();
+}
+
+void LateralDiffusion::clear() {
+
+    mNFrames = 0;
+    mFirst.clear();
+    mLast.clear();
+    mTrajectory.clear();
+    mDrift.clear();
+}
+
+/// -----------------------------------------------------------------------------
+//! unwrap the positions of one frame
+/// -----------------------------------------------------------------------------
+void LateralDiffusion::add_frame(float *_, int n, int d, float bx, float by, bool verbose) {
+
+    const size_t nlipids = mSpecies.size();
+    if (size_t(n) != nlipids || d < 2) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::add_frame(): expected " << nlipids << " x 2/3 positions, got "
+               << n << " x " << d << "!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    if (verbose) {
+        std::cout << "   > " << this->tag() << "::add_frame(" << mNFrames << ")...";
+        fflush(stdout);
+    }
+
+    const double boxw[2] = {bx, by};
+    const size_t offset = mTrajectory.size();
+    mTrajectory.resize(offset + 2*nlipids);
+
+    float *curr = mTrajectory.data() + offset;
+
+    // the first frame is the origin of the displacements
+    if (mNFrames == 0) {
+        mFirst.resize(2*nlipids);
+        mLast.resize(2*nlipids);
+        for(size_t i = 0; i < nlipids; i++) {
+            mFirst[2*i]   = mLast[2*i]   = _[d*i];
+            mFirst[2*i+1] = mLast[2*i+1] = _[d*i+1];
+        }
+        std::fill(curr, curr + 2*nlipids, 0.0f);
+    }
+
+    // minimum image displacement from the previous frame
+    else {
+
+        const float *prev = curr - 2*nlipids;
+
+        #pragma omp parallel for schedule(static)
+        for(TypeIndexI i = 0; i < TypeIndexI(nlipids); i++) {
+            for(uint8_t k = 0; k < 2; k++) {
+
+                const double p = _[d*i+k];
+                double dp = p - mLast[2*i+k];
+                if (boxw[k] > 0)
+                    dp -= boxw[k] * std::round(dp / boxw[k]);
+
+                curr[2*i+k] = prev[2*i+k] + dp;
+                mLast[2*i+k] = p;
+            }
+        }
+    }
+
+    double drift[2] = {0, 0};
+    for(size_t i = 0; i < nlipids; i++) {
+        drift[0] += curr[2*i];
+        drift[1] += curr[2*i+1];
+    }
+    mDrift.push_back(drift[0] / double(nlipids));
+    mDrift.push_back(drift[1] / double(nlipids));
+    mNFrames++;
+
+    if (verbose)
+        std::cout << " Done! drift = (" << mDrift[2*mNFrames-2] << ", " << mDrift[2*mNFrames-1] << ")\n";
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+std::vector<TypeFunction> LateralDiffusion::trajectory(int lipid, bool remove_drift) const {
+
+    if (lipid < 0 || size_t(lipid) >= mSpecies.size()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::trajectory(): Invalid lipid (" << lipid << ")!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    const size_t nlipids = mSpecies.size();
+    std::vector<TypeFunction> traj (2*mNFrames);
+    for(size_t t = 0; t < mNFrames; t++) {
+    for(uint8_t k = 0; k < 2; k++) {
+        double p = mFirst[2*lipid+k] + mTrajectory[2*(t*nlipids+lipid)+k];
+        if (remove_drift)
+            p -= mDrift[2*t+k];
+        traj[2*t+k] = p;
+    }}
+    return traj;
+}
+
+/// -----------------------------------------------------------------------------
+//! the fft-based msd, averaged over the lipids of a species
+//!     for positions r_0 .. r_{T-1}, with D_t = |r_t|^2,
+//!         S1(m) = 1/(T-m) sum_{t=0}^{T-m-1} (D_t + D_{t+m})     (computed recursively)
+//!         S2(m) = 1/(T-m) sum_{t=0}^{T-m-1} r_t . r_{t+m}       (autocorrelation)
+//!     the autocorrelation is computed by zero padding to (at least) 2T, so that
+//!     the circular correlation of the fft equals the linear one
+/// -----------------------------------------------------------------------------
+std::vector<TypeFunction> LateralDiffusion::msd(int species, bool remove_drift, bool verbose) const {
+
+    if (species < -1 || species >= int(mNSpecies)) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::msd(): Invalid species (" << species << "); there are "
+               << mNSpecies << " species!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    const size_t nlipids = mSpecies.size();
+    const size_t T = mNFrames;
+
+    std::vector<TypeIndex> lipids;
+    for(size_t i = 0; i < nlipids; i++) {
+        if (species == -1 || int(mSpecies[i]) == species)
+            lipids.push_back(i);
+    }
+
+    std::vector<TypeFunction> result (T, 0);
+    if (T == 0 || lipids.empty())
+        return result;
+
+    if (verbose) {
+        std::cout << "   > " << this->tag() << "::msd(" << lipids.size() << " lipids, " << T << " frames)...";
+        fflush(stdout);
+    }
+
+    size_t nfft = 1;
+    while (nfft < 2*T)
+        nfft <<= 1;
+
+    std::vector<double> sum (T, 0);
+
+    #pragma omp parallel
+    {
+    Eigen::FFT<double> fft;
+    std::vector<double> x (nfft), D (T), s2 (T, 0), lsum (T, 0), corr;
+    std::vector<std::complex<double>> X;
+
+    #pragma omp for schedule(static)
+    for(TypeIndexI l = 0; l < TypeIndexI(lipids.size()); l++) {
+
+        const size_t i = lipids[l];
+        std::fill(D.begin(), D.end(), 0.0);
+        std::fill(s2.begin(), s2.end(), 0.0);
+
+        for(uint8_t k = 0; k < 2; k++) {
+
+            std::fill(x.begin(), x.end(), 0.0);
+            for(size_t t = 0; t < T; t++) {
+                x[t] = mTrajectory[2*(t*nlipids+i)+k];
+                if (remove_drift)
+                    x[t] -= mDrift[2*t+k];
+                D[t] += x[t]*x[t];
+            }
+
+            fft.fwd(X, x);
+            for(auto iter = X.begin(); iter != X.end(); iter++)
+                *iter = std::norm(*iter);
+            fft.inv(corr, X);
+
+            for(size_t m = 0; m < T; m++)
+                s2[m] += corr[m];
+        }
+
+        double Q = 0;
+        for(size_t t = 0; t < T; t++)
+            Q += 2*D[t];
+
+        for(size_t m = 0; m < T; m++) {
+            if (m > 0)
+                Q -= D[m-1] + D[T-m];
+            lsum[m] += (Q - 2*s2[m]) / double(T-m);
+        }
+    }
+
+    #pragma omp critical
+    for(size_t m = 0; m < T; m++)
+        sum[m] += lsum[m];
+    }
+
+    for(size_t m = 0; m < T; m++)
+        result[m] = sum[m] / double(lipids.size());
+
+    if (verbose)
+        std::cout << " Done!\n";
+    return result;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
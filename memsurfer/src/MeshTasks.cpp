@@ -0,0 +1,164 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "TriMesh.hpp"
+#include "MeshTasks.hpp"
+#include "TaskGraph.hpp"
+#include "DensityKernels.hpp"
+#include "DistanceKernels.hpp"
+
+/// -----------------------------------------------------------------------------
+void MeshTasks::add(const TaskType type, TriMesh &mesh) {
+
+    Request r;
+    r.type = type;
+    r.mesh = &mesh;
+    r.ktype = 0;
+    r.sigma = 0;
+    r.get_counts = false;
+    r.tolerance = 0;
+    r.knn = 0;
+    r.fast_exp = false;
+    mRequests.push_back(r);
+}
+
+void MeshTasks::add_density(TriMesh &mesh, const std::string &name, const int type, const float sigma,
+                            const bool get_counts, const std::vector<TypeIndexI> &ids,
+                            const float tolerance, const int knn, const bool fast_exp) {
+
+    if (type < 1 || type > 5) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::add_density(" << name << "): Invalid density type " << type << "!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (type != 4 && !(sigma > 0)) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::add_density(" << name << "): Invalid sigma " << sigma << "!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    add(DENSITY, mesh);
+    Request &r = mRequests.back();
+    r.name = name;
+    r.ktype = type;
+    r.sigma = sigma;
+    r.get_counts = get_counts;
+    r.ids = ids;
+    r.tolerance = tolerance;
+    r.knn = knn;
+    r.fast_exp = fast_exp;
+}
+
+/// -----------------------------------------------------------------------------
+//! every request is a task that writes the cached properties it computes
+//!     (keyed by the mesh), e.g., the geodesic densities (type 1) of a mesh all
+//!     write its geodesic distances, and therefore run one after another
+/// -----------------------------------------------------------------------------
+
+void MeshTasks::run(int nthreads, bool verbose) {
+
+    if (mRequests.empty())
+        return;
+
+    if (verbose) {
+        std::cout << "   > " << tag() << "::run(" << mRequests.size() << " tasks)...";
+        fflush(stdout);
+    }
+
+    TaskGraph graph;
+
+    for(size_t i = 0; i < mRequests.size(); i++) {
+
+        const Request &r = mRequests[i];
+        TriMesh &mesh = *r.mesh;
+
+        std::ostringstream key;
+        key << r.mesh << ":";
+
+        // the region of interest is shared by the tasks (computed here, before they run)
+        mesh.need_roi();
+
+        std::vector<std::string> outputs;
+        switch (r.type) {
+
+            case NORMALS:
+                mesh.reserve("_normals", false);
+                outputs.push_back(key.str() + "_normals");
+                graph.add("normals", {}, outputs, [&mesh]{ mesh.need_normals(); });
+                break;
+
+            case POINTAREAS:
+                mesh.reserve("point_areas", true);
+                outputs.push_back(key.str() + "point_areas");
+                graph.add("point_areas", {}, outputs, [&mesh]{ mesh.need_pointareas(); });
+                break;
+
+            case CURVATURE:
+                mesh.reserve("curv_mean", true);
+                mesh.reserve("curv_gauss", true);
+                outputs.push_back(key.str() + "curv_mean");
+                outputs.push_back(key.str() + "curv_gauss");
+                graph.add("curvature", {}, outputs, [&mesh]{ mesh.need_curvature(); });
+                break;
+
+            case DENSITY:
+                mesh.reserve(r.name, true);
+                outputs.push_back(key.str() + r.name);
+                if (r.ktype == 1) {
+                    mesh.reserve("_geodesics", false);
+                    outputs.push_back(key.str() + "_geodesics");
+                }
+                if (r.ktype == 5) {
+                    mesh.reserve("_heat", false);
+                    mesh.reserve("point_areas", true);
+                    mesh.reserve("_op_laplacian", false);
+                    outputs.push_back(key.str() + "_heat");
+                    outputs.push_back(key.str() + "point_areas");
+                    outputs.push_back(key.str() + "_op_laplacian");
+                }
+                graph.add(r.name, {}, outputs, [&mesh, &r]{
+
+                    std::unique_ptr<GaussianKernel> dens;
+                    if (r.ktype == 3)   dens.reset(new GaussianKernel3D(r.sigma));
+                    else                dens.reset(new GaussianKernel2D(r.ktype == 4 ? 1 : r.sigma));
+                    dens->set_fast_exp(r.fast_exp);
+
+                    std::unique_ptr<DistanceKernel> dist;
+                    if (mesh.mPeriodic) dist.reset(new DistancePeriodicXYSquared(mesh.mBox0, mesh.mBox1));
+                    else                dist.reset(new DistanceSquared());
+
+                    mesh.kde(r.name, r.ktype, r.get_counts, *dens, *dist, r.ids, r.tolerance, r.knn);
+                });
+                break;
+        }
+    }
+
+    // the queue is cleared even if a task fails
+    std::vector<Request> requests;
+    requests.swap(mRequests);
+    graph.run(nthreads);
+
+    if (verbose)
+        std::cout << " Done!\n";
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
@@ -0,0 +1,204 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Numa.hpp"
+
+/// -----------------------------------------------------------------------------
+//! settings
+/// -----------------------------------------------------------------------------
+
+static bool numa_first_touch = false;
+static bool numa_huge_pages = false;
+static size_t numa_min_bytes = size_t(2) << 20;
+
+void Numa::set_first_touch(const bool enable) {     numa_first_touch = enable;  }
+void Numa::set_huge_pages(const bool enable) {      numa_huge_pages = enable;   }
+void Numa::set_min_bytes(const size_t nbytes) {     numa_min_bytes = nbytes;    }
+
+bool Numa::first_touch() {      return numa_first_touch;    }
+bool Numa::huge_pages() {       return numa_huge_pages;     }
+size_t Numa::min_bytes() {      return numa_min_bytes;      }
+
+/// -----------------------------------------------------------------------------
+//! memory
+/// -----------------------------------------------------------------------------
+
+void Numa::prepare(void *ptr, const size_t nbytes) {
+
+#ifdef __linux__
+    const uintptr_t psize = uintptr_t(sysconf(_SC_PAGESIZE));
+    const uintptr_t b = (uintptr_t(ptr) + psize - 1) / psize * psize;
+    const uintptr_t e = (uintptr_t(ptr) + nbytes) / psize * psize;
+    if (e <= b)
+        return;
+
+#ifdef MADV_HUGEPAGE
+    if (numa_huge_pages)
+        madvise((void*) b, e-b, MADV_HUGEPAGE);
+#endif
+
+    // the released pages read as zeros, and are placed where they are touched next
+    if (numa_first_touch)
+        madvise((void*) b, e-b, MADV_DONTNEED);
+#else
+    (void) ptr;
+    (void) nbytes;
+#endif
+}
+
+/// -----------------------------------------------------------------------------
+//! topology
+/// -----------------------------------------------------------------------------
+
+//! parse a cpu list, e.g., "0-7,16-23"
+static std::vector<int> parse_cpulist(const std::string &list) {
+
+    std::vector<int> cpus;
+    std::istringstream ss (list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty())
+            continue;
+        const size_t dash = range.find('-');
+        const int a = std::stoi(range.substr(0, dash));
+        const int b = (dash == std::string::npos) ? a : std::stoi(range.substr(dash+1));
+        for(int c = a; c <= b; c++)
+            cpus.push_back(c);
+    }
+    return cpus;
+}
+
+//! the cpus of every memory node (a single node if the topology is not available)
+static std::vector<std::vector<int>> node_cpus() {
+
+    std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+    for(int n = 0; ; n++) {
+        std::ifstream f ("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        if (!f.is_open())
+            break;
+        std::string list;
+        std::getline(f, list);
+        nodes.push_back(parse_cpulist(list));
+    }
+#endif
+    if (nodes.empty()) {
+        nodes.push_back(std::vector<int>());
+        const int ncpus = std::max(1, int(std::thread::hardware_concurrency()));
+        for(int c = 0; c < ncpus; c++)
+            nodes.back().push_back(c);
+    }
+    return nodes;
+}
+
+int Numa::num_nodes() {
+    return int(node_cpus().size());
+}
+
+/// -----------------------------------------------------------------------------
+//! threads
+/// -----------------------------------------------------------------------------
+
+int Numa::pin_threads(const std::string &policy) {
+
+    if (policy != "compact" && policy != "spread" && policy != "none") {
+        std::ostringstream errMsg;
+        errMsg << " Numa::pin_threads(): Invalid policy (" << policy << "). Should be compact, spread, or none!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+
+#if defined(__linux__) && defined(_OPENMP)
+
+    // the affinity of the process when first pinned (restored by "none")
+    static bool saved = false;
+    static cpu_set_t original;
+    if (!saved) {
+        CPU_ZERO(&original);
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &original) != 0)
+            return 0;
+        saved = true;
+    }
+
+    // the allowed cpus in the order of the policy
+    const std::vector<std::vector<int>> nodes = node_cpus();
+    std::vector<std::vector<int>> allowed (nodes.size());
+    for(size_t n = 0; n < nodes.size(); n++) {
+        for(auto iter = nodes[n].begin(); iter != nodes[n].end(); iter++) {
+            if (*iter < CPU_SETSIZE && CPU_ISSET(*iter, &original))
+                allowed[n].push_back(*iter);
+        }
+    }
+
+    std::vector<int> order;
+    if (policy == "spread") {
+        for(size_t k = 0; ; k++) {
+            bool any = false;
+            for(size_t n = 0; n < allowed.size(); n++) {
+                if (k < allowed[n].size()) {
+                    order.push_back(allowed[n][k]);
+                    any = true;
+                }
+            }
+            if (!any)
+                break;
+        }
+    }
+    else {
+        for(size_t n = 0; n < allowed.size(); n++)
+            order.insert(order.end(), allowed[n].begin(), allowed[n].end());
+    }
+    if (order.empty())
+        return 0;
+
+    int npinned = 0;
+    #pragma omp parallel reduction(+:npinned)
+    {
+        cpu_set_t mask;
+        if (policy == "none") {
+            mask = original;
+        }
+        else {
+            CPU_ZERO(&mask);
+            CPU_SET(order[omp_get_thread_num() % order.size()], &mask);
+        }
+        if (sched_setaffinity(0, sizeof(cpu_set_t), &mask) == 0)
+            npinned += (policy == "none") ? 0 : 1;
+    }
+    return npinned;
+#else
+    return 0;
+#endif
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
@@ -12,11 +12,16 @@ For details, see https://github.com/LLNL/MemSurfer.
 /// ----------------------------------------------------------------------------
 /// ----------------------------------------------------------------------------
 
+#include <cmath>
 #include <sstream>
+#include <algorithm>
 #include <stdexcept>
 
 #include "PointSet.hpp"
 #include "TriMesh.hpp"
+#include "CellList.hpp"
+#include "DistanceKernels.hpp"
+#include "Serialization.hpp"
 
 //! ----------------------------------------------------------------------------
 //! PointSet constructor
@@ -91,14 +96,7 @@ std::vector<TypeFunction> PointSet::get_normals() {
 //! set periodic box
 //! ----------------------------------------------------------------------------
 
-void PointSet::set_periodic(const std::vector<TypeFunction> &box, const TypeFunction thickness, const bool verbose) {
-
-    if(thickness <= 0 || thickness >= 1) {
-
-        std::ostringstream errMsg;
-        errMsg << " PointSet::set_periodic(): Invalid thickness of boundary layer (should be 0 < t < 1)! got " << thickness << "!\n";
-        throw std::invalid_argument(errMsg.str());
-    }
+void PointSet::set_box(const std::vector<TypeFunction> &box) {
 
     switch (box.size()) {
         case 3:     mBox0 = std::vector<TypeFunction>({0, 0, 0});                   mBox1 = std::vector<TypeFunction>({box[0], box[1], box[2]});     break;
@@ -109,18 +107,25 @@ void PointSet::set_periodic(const std::vector<TypeFunction> &box, const TypeFunc
                     throw std::invalid_argument(errMsg.str());
                     }
     }
+}
+
+//! duplicate the points within width (in x and y) of the boundary of the box
+//!     (any previously duplicated points are removed first)
+void PointSet::duplicate_boundary(const TypeFunction width[2]) {
+
+    mPoints.resize(mnPoints);
+    valid_normals = false;
 
     // width of the box
     const TypeFunction boxw[2] = {mBox1[0]-mBox0[0], mBox1[1]-mBox0[1]};
 
     // cutoffs for the points to duplicate
-    const TypeFunction lcutoff[2] = { mBox0[0] + thickness*boxw[0], mBox0[1] + thickness*boxw[1] };
-    const TypeFunction rcutoff[2] = { mBox1[0] - thickness*boxw[0], mBox1[1] - thickness*boxw[1] };
+    const TypeFunction lcutoff[2] = { mBox0[0] + width[0], mBox0[1] + width[1] };
+    const TypeFunction rcutoff[2] = { mBox1[0] - width[0], mBox1[1] - width[1] };
 
     // start duplicating
-    auto eiter = mPoints.end();
-    for (auto iter = mPoints.begin(); iter != eiter; ++iter) {
-        const Point3 &p = iter->first;
+    for (size_t i = 0; i < mnPoints; ++i) {
+        const Point3 p = mPoints[i].first;
         bool lx = p[0] < lcutoff[0];
         bool ly = p[1] < lcutoff[1];
 
@@ -141,11 +146,82 @@ void PointSet::set_periodic(const std::vector<TypeFunction> &box, const TypeFunc
        else if (rx && ly) {    mPoints.push_back(create_point(p[0]-boxw[0], p[1]+boxw[1], p[2]));   }
        else if (rx && ry) {    mPoints.push_back(create_point(p[0]-boxw[0], p[1]-boxw[1], p[2]));   }
     }
+}
+
+void PointSet::set_periodic(const std::vector<TypeFunction> &box, const TypeFunction thickness, const bool verbose) {
+
+    if(thickness <= 0 || thickness >= 1) {
+
+        std::ostringstream errMsg;
+        errMsg << " PointSet::set_periodic(): Invalid thickness of boundary layer (should be 0 < t < 1)! got " << thickness << "!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    set_box(box);
+
+    const TypeFunction width[2] = {thickness*(mBox1[0]-mBox0[0]), thickness*(mBox1[1]-mBox0[1])};
+    duplicate_boundary(width);
 
     if (verbose)
         std::cout << "   > PointSet::set_periodic(" << thickness << ") duplicated " << mPoints.size()-mnPoints << " points!\n";
 }
 
+//! ----------------------------------------------------------------------------
+//! set periodic box with a boundary layer sized by the neighborhoods
+//!     the k nearest neighbors (in 3D, closest periodic image in xy) of every
+//!     point are within the largest knn-distance, so a layer of (scale times)
+//!     that width gives every point near the boundary its complete neighborhood
+//! ----------------------------------------------------------------------------
+
+TypeFunction PointSet::set_periodic_knn(const std::vector<TypeFunction> &box, const TypeIndex knn,
+                                        const TypeFunction scale, const bool verbose) {
+
+    if (knn == 0 || scale < 1) {
+        std::ostringstream errMsg;
+        errMsg << " PointSet::set_periodic_knn(): Invalid knn (" << knn << ") or scale (" << scale << "), need knn > 0 and scale >= 1!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    set_box(box);
+    mPoints.resize(mnPoints);
+
+    const Vertex box0 (mBox0[0], mBox0[1], mBox0[2]);
+    const Vertex box1 (mBox1[0], mBox1[1], mBox1[2]);
+    const TypeFunction boxw[2] = {box1[0]-box0[0], box1[1]-box0[1]};
+
+    std::vector<Vertex> points (mnPoints);
+    for(size_t i = 0; i < mnPoints; i++) {
+        const Point3 &p = mPoints[i].first;
+        points[i] = Vertex(p[0], p[1], p[2]);
+    }
+
+    // the expected knn-distance of uniformly distributed points (as a start)
+    const TypeFunction r0 = std::sqrt(TypeFunction(knn) * boxw[0] * boxw[1] / (M_PI * std::max(size_t(1), mnPoints)));
+
+    DistancePeriodicXYSquared dist (box0, box1);
+    CellList cells (points, std::vector<TypeIndexI>(), dist, 3, r0);
+
+    std::vector<TypeFunction> rknn (mnPoints, 0);
+
+    #pragma omp parallel for
+    for(TypeIndexI i = 0; i < TypeIndexI(mnPoints); i++) {
+        rknn[i] = cells.knn_distance(TypeIndex(i), knn, r0);
+    }
+
+    const TypeFunction rmax = rknn.empty() ? 0 : *std::max_element(rknn.begin(), rknn.end());
+
+    // the layer should not reach beyond the opposite half of the box
+    const TypeFunction width[2] = {std::min(scale*rmax, TypeFunction(0.5*boxw[0])),
+                                   std::min(scale*rmax, TypeFunction(0.5*boxw[1]))};
+    duplicate_boundary(width);
+
+    if (verbose)
+        std::cout << "   > PointSet::set_periodic_knn(" << knn << ") layer = " << width[0] << " x " << width[1]
+                  << ", duplicated " << mPoints.size()-mnPoints << " points!\n";
+
+    return std::max(width[0], width[1]);
+}
+
 //! ----------------------------------------------------------------------------
 //! compute point normals
 //! ----------------------------------------------------------------------------
@@ -312,5 +388,99 @@ TriMesh* PointSet::need_approximate_surface(bool verbose) {
     return new TriMesh(surface_mesh);
 }
 #endif
+
+//! ----------------------------------------------------------------------------
+//! binary serialization
+//!     magic, version, number of given points, points and normals (as doubles),
+//!     bbox, and whether the normals are valid
+//! ----------------------------------------------------------------------------
+
+static const uint32_t PS_MAGIC = 0x5350534d;       // "MSPS"
+static const uint32_t PS_VERSION = 1;
+
+static void serialize_pointset(ByteWriter &writer, const std::vector<Point_with_normal> &points,
+                               const size_t npoints, const std::vector<TypeFunction> &box0,
+                               const std::vector<TypeFunction> &box1, const bool valid_normals) {
+
+    std::vector<double> coords;
+    coords.reserve(6*points.size());
+    for(auto iter = points.begin(); iter != points.end(); ++iter) {
+        const Point3 &p = iter->first;
+        const Vector3 &n = iter->second;
+        coords.push_back(CGAL::to_double(p[0]));  coords.push_back(CGAL::to_double(p[1]));  coords.push_back(CGAL::to_double(p[2]));
+        coords.push_back(CGAL::to_double(n[0]));  coords.push_back(CGAL::to_double(n[1]));  coords.push_back(CGAL::to_double(n[2]));
+    }
+
+    writer.write(PS_MAGIC);
+    writer.write(PS_VERSION);
+    writer.write(uint64_t(npoints));
+    writer.write(coords);
+    writer.write(box0);
+    writer.write(box1);
+    writer.write(uint8_t(valid_normals));
+}
+
+size_t PointSet::serialized_size() const {
+    ByteWriter writer;
+    serialize_pointset(writer, mPoints, mnPoints, mBox0, mBox1, valid_normals);
+    return writer.size();
+}
+
+size_t PointSet::serialize(uint8_t *_, size_t n) const {
+    ByteWriter writer(_, n);
+    serialize_pointset(writer, mPoints, mnPoints, mBox0, mBox1, valid_normals);
+    return writer.size();
+}
+
+bool PointSet::deserialize(const uint8_t *buffer, size_t nbytes) {
+
+    ByteReader reader(buffer, nbytes);
+
+    uint32_t magic = 0, version = 0;
+    reader.read(magic);
+    reader.read(version);
+    if (magic != PS_MAGIC || version != PS_VERSION) {
+        std::ostringstream errMsg;
+        errMsg << " PointSet::deserialize(): Invalid buffer (magic = " << magic << ", version = " << version << ")!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    // read everything before modifying this point set
+    uint64_t npoints = 0;
+    std::vector<double> coords;
+    std::vector<TypeFunction> box0, box1;
+    uint8_t vnormals = 0;
+
+    reader.read(npoints);
+    reader.read(coords);
+    reader.read(box0);
+    reader.read(box1);
+    reader.read(vnormals);
+
+    if (coords.size() % 6 != 0 || 6*npoints > coords.size()) {
+        std::ostringstream errMsg;
+        errMsg << " PointSet::deserialize(): Invalid points (" << npoints << " points, " << coords.size() << " values)!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (box0.size() != box1.size() || (!box0.empty() && box0.size() != 3)) {
+        std::ostringstream errMsg;
+        errMsg << " PointSet::deserialize(): Invalid box (" << box0.size() << " and " << box1.size() << " values)!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    const size_t ntotal = coords.size() / 6;
+    std::vector<Point_with_normal> points (ntotal);
+    for(size_t i = 0; i < ntotal; i++) {
+        const double *c = &coords[6*i];
+        points[i] = Point_with_normal(Point3(c[0], c[1], c[2]), Vector3(c[3], c[4], c[5]));
+    }
+
+    mPoints.swap(points);
+    mBox0.swap(box0);
+    mBox1.swap(box1);
+    mnPoints = npoints;
+    valid_normals = bool(vnormals);
+    return true;
+}
 //! ----------------------------------------------------------------------------
 //! ----------------------------------------------------------------------------
@@ -13,6 +13,7 @@ For details, see https://github.com/LLNL/MemSurfer.
 /// ----------------------------------------------------------------------------
 
 #include <map>
+#include <cmath>
 #include <sstream>
 #include <fstream>
 #include <stdexcept>
@@ -20,6 +21,7 @@ For details, see https://github.com/LLNL/MemSurfer.
 #include <unordered_set>
 
 #include "TriMesh.hpp"
+#include "Periodic.hpp"
 
 //! -----------------------------------------------------------------------------
 //! static functions
@@ -88,11 +90,49 @@ bool TriMesh::set_bbox(float *_, int n) {
         throw std::invalid_argument(errMsg.str());
     }
     bbox_valid = true;
+    this->geometry_changed();
+    return true;
+}
+
+//! -----------------------------------------------------------------------------
+//! update the vertices in place
+//! -----------------------------------------------------------------------------
+
+bool TriMesh::update_vertices(float *_, int n, int d) {
+
+    if (size_t(n) != mVertices.size() || d != int(mDim)) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::update_vertices(): got " << n << " " << d << "D vertices for a mesh with "
+               << mVertices.size() << " " << int(mDim) << "D vertices!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    // overwrite the positions (no reallocation)
+    this->delinearize<3,TypeFunction,float>(_,n,d,mVertices);
+    this->geometry_changed();
+
+    // the duplicated (periodic) vertices follow the original ones
+    if (this->mPeriodic && !this->mDuplicateVerts.empty()) {
+
+        const Vertex boxw = mBox1 - mBox0;
+        const size_t ndups = mDuplicateVerts.size();
+        for(size_t i = 0; i < ndups; i++) {
+
+            const periodicVertex &pvertex = mDuplicateVertex_periodic[i];
+            Vertex &dv = mDuplicateVerts[i];
+
+            dv = mVertices[std::get<0>(pvertex)];
+            dv[0] += float(std::get<1>(pvertex)) * boxw[0];
+            dv[1] += float(std::get<2>(pvertex)) * boxw[1];
+        }
+    }
     return true;
 }
 
 //! -----------------------------------------------------------------------------
 //! compute vertex normals
+//!     the per-face terms are computed in parallel, and gathered at the vertices
+//!     in the order of the faces, so the result does not depend on the threads
 //! -----------------------------------------------------------------------------
 
 // static
@@ -102,8 +142,9 @@ void TriMesh::need_normals(const std::vector<Face> &faces, const std::vector<Ver
     const size_t nv = vertices.size();
     const size_t nf = faces.size();
 
-    fnormals.resize(nf, Normal(0,0,0));
-    pnormals.resize(nv, Normal(0,0,0));
+    Numa::assign(fnormals, nf, Normal(0,0,0));
+    Numa::assign(pnormals, nv, Normal(0,0,0));
+    std::vector<Vertex> weights(nf, Vertex(0,0,0));
 
 #pragma omp parallel for
     for (size_t i = 0; i < nf; i++) {
@@ -120,10 +161,16 @@ void TriMesh::need_normals(const std::vector<Face> &faces, const std::vector<Ver
             continue;
 
         fnormals[i] = a CROSS b;
+        weights[i] = Vertex(TypeFunction(1.0 / (l2a * l2c)),
+                            TypeFunction(1.0 / (l2b * l2a)),
+                            TypeFunction(1.0 / (l2c * l2b)));
+    }
 
-        pnormals[f[0]] += fnormals[i] * TypeFunction(1.0 / (l2a * l2c));
-        pnormals[f[1]] += fnormals[i] * TypeFunction(1.0 / (l2b * l2a));
-        pnormals[f[2]] += fnormals[i] * TypeFunction(1.0 / (l2c * l2b));
+    for (size_t i = 0; i < nf; i++) {
+        if (!weights[i][0])
+            continue;
+        for (uint8_t k = 0; k < 3; k++)
+            pnormals[faces[i][k]] += fnormals[i] * weights[i][k];
     }
 
     // Make them all unit-length
@@ -134,6 +181,7 @@ void TriMesh::need_normals(const std::vector<Face> &faces, const std::vector<Ver
 
 //! -----------------------------------------------------------------------------
 //! compute per-vertex point areas
+//!     (gathered in the order of the faces, as the normals)
 //! -----------------------------------------------------------------------------
 
 // static
@@ -143,7 +191,7 @@ void TriMesh::need_pointareas(const std::vector<Face> &faces, const std::vector<
     size_t nv = vertices.size();
     size_t nf = faces.size();
 
-    areas.resize(nv, 0.0);
+    Numa::assign(areas, nv, TypeFunction(0));
     std::vector<Vertex> cornerareas(nf);
 
 #pragma omp parallel for
@@ -180,11 +228,11 @@ void TriMesh::need_pointareas(const std::vector<Face> &faces, const std::vector<
             for (uint8_t j = 0; j < 3; j++)
                 cornerareas[i][j] = ewscale * (ew[(j+1)%3] + ew[(j+2)%3]);
         }
-#pragma omp atomic
+    }
+
+    for (size_t i = 0; i < nf; i++) {
         areas[faces[i][0]] += cornerareas[i][0];
-#pragma omp atomic
         areas[faces[i][1]] += cornerareas[i][1];
-#pragma omp atomic
         areas[faces[i][2]] += cornerareas[i][2];
     }
 }
@@ -433,6 +481,7 @@ bool TriMesh::wrap_vertices(uint8_t dim) {
         if (x >= this->mBox1[d])  x -= boxw[d];
     }
     }
+    this->geometry_changed();
     return true;
 }
 
@@ -444,6 +493,7 @@ void TriMesh::trim_periodicDelaunay(bool verbose) {
         throw std::invalid_argument(errMsg.str());
     }
 
+    this->topology_changed();
     this->mFaces.clear();
     this->mPeriodicFaces.clear();
     this->mTrimmedFaces.clear();
@@ -519,6 +569,194 @@ void TriMesh::trim_periodicDelaunay(bool verbose) {
     }
 }
 
+//! -----------------------------------------------------------------------------
+//! lipid tilt
+//! -----------------------------------------------------------------------------
+
+std::vector<TypeFunction> TriMesh::need_tilt(float *heads, int nh, int dh, float *tails, int nt, int dt,
+                                             bool verbose) {
+
+    const size_t nverts = mVertices.size();
+    if (size_t(nh) != nverts || size_t(nt) != nverts || dh != 3 || dt != 3) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::need_tilt(): Expected " << nverts << " 3D heads and tails, got ("
+               << nh << ", " << dh << ") and (" << nt << ", " << dt << ")!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (this->mPeriodic && !this->bbox_valid) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::need_tilt(): Bounding box not available!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    this->need_normals(verbose);
+
+    if (verbose) {
+        std::cout << "   > " << tag() << "::need_tilt()...";
+        fflush(stdout);
+    }
+
+    const bool periodic = this->mPeriodic;
+    const Vertex boxw = this->mBox1 - this->mBox0;
+
+    std::vector<TypeFunction> &angle = mFields["tilt_angle"];
+    std::vector<TypeFunction> &dx = mFields["tilt_director_x"];
+    std::vector<TypeFunction> &dy = mFields["tilt_director_y"];
+    std::vector<TypeFunction> &dz = mFields["tilt_director_z"];
+    angle.assign(nverts, 0);
+    dx.assign(nverts, 0);
+    dy.assign(nverts, 0);
+    dz.assign(nverts, 0);
+
+    #pragma omp parallel for
+    for(TypeIndexI i = 0; i < TypeIndexI(nverts); i++) {
+
+        // head-tail vector (minimum image in xy)
+        Vertex v (heads[3*i]-tails[3*i], heads[3*i+1]-tails[3*i+1], heads[3*i+2]-tails[3*i+2]);
+        if (periodic)
+            min_image_xy(v, boxw);
+
+        const TypeFunction l = len(v);
+        if (l <= 0)
+            continue;
+        v /= l;
+
+        const Normal &n = mPointNormals[i];
+        const TypeFunction c = std::max(TypeFunction(-1), std::min(TypeFunction(1), v DOT n));
+        angle[i] = std::acos(c) * TypeFunction(180.0 / M_PI);
+
+        // in-plane director
+        Vertex p = v - c*n;
+        const TypeFunction lp = len(p);
+        if (lp > 1e-6) {
+            p /= lp;
+            dx[i] = p[0];     dy[i] = p[1];     dz[i] = p[2];
+        }
+    }
+
+    stamp("tilt_angle");
+    stamp("tilt_director_x");
+    stamp("tilt_director_y");
+    stamp("tilt_director_z");
+
+    std::vector<TypeFunction> tilt (4*nverts);
+    for(size_t i = 0; i < nverts; i++) {
+        tilt[4*i] = angle[i];
+        tilt[4*i+1] = dx[i];
+        tilt[4*i+2] = dy[i];
+        tilt[4*i+3] = dz[i];
+    }
+
+    if (verbose) {
+        std::cout << " Done!\n";
+    }
+    return tilt;
+}
+
+//! -----------------------------------------------------------------------------
+//! Taubin smoothing
+//! -----------------------------------------------------------------------------
+
+std::vector<TypeFunction> TriMesh::smooth_taubin(const TypeFunction lambda, const TypeFunction mu,
+                                                 const int niters, bool verbose) const {
+
+    if (niters < 0 || lambda <= 0 || mu >= 0) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::smooth_taubin(" << lambda << ", " << mu << ", " << niters
+               << "): need lambda > 0, mu < 0, and niters >= 0!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (this->mPeriodic && !this->bbox_valid) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::smooth_taubin(): Bounding box not available!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    if (verbose) {
+        std::cout << "   > " << tag() << "::smooth_taubin(" << lambda << ", " << mu << ", " << niters << ")...";
+        fflush(stdout);
+    }
+
+    const size_t nverts = mVertices.size();
+
+    // -------------------------------------------------------------------------
+    // neighbors in compressed sparse row format
+    //  (faces across the periodic boundary connect the original vertices)
+    std::vector<uint64_t> edges;
+    edges.reserve(6*(mFaces.size() + mPeriodicFaces.size()));
+    for(uint8_t s = 0; s < 2; s++) {
+        const std::vector<Face> &faces = (s == 0) ? mFaces : mPeriodicFaces;
+        for(auto iter = faces.begin(); iter != faces.end(); iter++) {
+        for(uint8_t d = 0; d < 3; d++) {
+            const uint64_t a = (*iter)[d], b = (*iter)[(d+1)%3];
+            edges.push_back((a << 32) | b);
+            edges.push_back((b << 32) | a);
+        }}
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::vector<TypeIndex> offsets (nverts+1, 0);
+    std::vector<TypeIndex> nbrs (edges.size());
+    for(size_t e = 0; e < edges.size(); e++) {
+        offsets[(edges[e] >> 32) + 1]++;
+        nbrs[e] = edges[e] & 0xffffffff;
+    }
+    for(size_t i = 0; i < nverts; i++)
+        offsets[i+1] += offsets[i];
+    edges.clear();
+
+    // -------------------------------------------------------------------------
+    // alternate shrinking (lambda) and inflating (mu) umbrella steps
+    const Vertex boxw = this->mBox1 - this->mBox0;
+    const bool periodic = this->mPeriodic;
+
+    std::vector<Vertex> vcurr = mVertices;
+    std::vector<Vertex> vnext (nverts);
+
+    for(int iter = 0; iter < 2*niters; iter++) {
+
+        const TypeFunction f = (iter % 2 == 0) ? lambda : mu;
+
+        #pragma omp parallel for
+        for(TypeIndexI i = 0; i < TypeIndexI(nverts); i++) {
+
+            const TypeIndex b = offsets[i], e = offsets[i+1];
+            if (b == e) {
+                vnext[i] = vcurr[i];
+                continue;
+            }
+
+            // umbrella operator (uniform weights, minimum image in xy)
+            Vertex lap (0,0,0);
+            for(TypeIndex j = b; j < e; j++) {
+                Vertex d = vcurr[nbrs[j]] - vcurr[i];
+                if (periodic)
+                    min_image_xy(d, boxw);
+                lap += d;
+            }
+            vnext[i] = vcurr[i] + (f / TypeFunction(e-b)) * lap;
+        }
+        vcurr.swap(vnext);
+    }
+
+    // bring the vertices back into the periodic box
+    if (periodic) {
+        for(size_t i = 0; i < nverts; i++) {
+        for(uint8_t d = 0; d < 2; d++) {
+            TypeFunction &x = vcurr[i][d];
+            if (x <  this->mBox0[d])  x += boxw[d];
+            if (x >= this->mBox1[d])  x -= boxw[d];
+        }
+        }
+    }
+
+    if (verbose) {
+        std::cout << " Done!\n";
+    }
+    return linearize<3,TypeFunction,TypeFunction>(vcurr, this->mDim);
+}
+
 //! -----------------------------------------------------------------------------
 //! read/write off format
 //! -----------------------------------------------------------------------------
@@ -13,6 +13,8 @@ For details, see https://github.com/LLNL/MemSurfer.
 /// ----------------------------------------------------------------------------
 
 #include <map>
+#include <cmath>
+#include <limits>
 #include<string>
 #include <sstream>
 #include <stdexcept>
@@ -35,6 +37,11 @@ TriMesh::TriMesh(const Polyhedron &P) {
 
     this->mDim = 3;
     this->mPeriodic = false;
+    this->mROIRadius = 0;
+    this->mROIGiven = false;
+    this->mGeometryVersion = 0;
+    this->mTopologyVersion = 0;
+    this->mROIVersion = 1;
 
     mVertices.resize(P.size_of_vertices());
     mFaces.resize(P.size_of_facets());
@@ -145,6 +152,7 @@ std::vector<TypeIndexI> TriMesh::delaunay(bool verbose) {
         vh->info() = cgalVertices[i].second;
     }
 
+    this->topology_changed();
     mFaces.clear();
     for(auto iter = dt.finite_faces_begin(); iter != dt.finite_faces_end(); ++iter) {
         mFaces.push_back(Face(iter->vertex(0)->info(), iter->vertex(1)->info(), iter->vertex(2)->info()));
@@ -235,6 +243,222 @@ std::vector<TypeIndexI> TriMesh::periodicDelaunay(bool verbose) {
 }
 
 
+//! -----------------------------------------------------------------------------
+//! regular (weighted Delaunay) triangulation
+//! -----------------------------------------------------------------------------
+
+#ifdef CGAL_AVAILABLE
+#include <CGAL/Regular_triangulation_2.h>
+#include <CGAL/Regular_triangulation_vertex_base_2.h>
+#include <CGAL/Regular_triangulation_face_base_2.h>
+
+//! the area of the power cell of a vertex of a regular triangulation
+//!     its boundary is given by the power centers (duals) of the incident faces
+//!     in ccw order (the point itself may lie outside of its cell)
+//!     infinite for a vertex on the convex hull
+template <typename Regular>
+static double power_cell_area(const Regular &rt, const typename Regular::Vertex_handle &vh) {
+
+    typename Regular::Face_circulator fc = rt.incident_faces(vh), done(fc);
+    if (fc == 0)
+        return 0;
+
+    const typename Regular::Bare_point p = vh->point().point();
+
+    double area = 0;
+    do {
+        typename Regular::Face_circulator fn = fc;
+        ++fn;
+        if (rt.is_infinite(fc) || rt.is_infinite(fn))
+            return std::numeric_limits<double>::infinity();
+
+        const typename Regular::Bare_point a = rt.dual(fc);
+        const typename Regular::Bare_point b = rt.dual(fn);
+        area += (a.x()-p.x())*(b.y()-p.y()) - (a.y()-p.y())*(b.x()-p.x());
+    } while (++fc != done);
+
+    return 0.5*area;
+}
+#endif
+
+std::vector<TypeIndexI> TriMesh::regular(float *_, int n, bool verbose) {
+
+    if (this->mPeriodic) {
+        return this->periodicRegular(_, n, verbose);
+    }
+
+#ifndef CGAL_AVAILABLE
+    std::cerr << " ERROR: " << this->tag() << "::regular - CGAL not available! cannot compute regular triangulation!\n";
+    return std::vector<TypeIndexI>();
+#else
+
+    if (this->mDim != 2) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::regular() requires a mesh in 2D!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (size_t(n) != this->mVertices.size()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::regular(): expected " << mVertices.size() << " weights, got " << n << "!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    typedef CGAL::Regular_triangulation_vertex_base_2<Kernel> Vb;
+    typedef CGAL::Triangulation_vertex_base_with_info_2<TypeIndex, Kernel, Vb> Vb_with_idx;
+    typedef CGAL::Regular_triangulation_face_base_2<Kernel> Fb;
+    typedef CGAL::Triangulation_data_structure_2<Vb_with_idx, Fb> Tds;
+    typedef CGAL::Regular_triangulation_2<Kernel, Tds> Regular;
+
+    if (verbose) {
+        std::cout << "   > " << this->tag() << "::regular()...";
+        fflush(stdout);
+    }
+
+    const size_t nverts = this->mVertices.size();
+
+    std::vector<std::pair<Regular::Weighted_point, TypeIndex>> wpoints (nverts);
+    for(size_t i = 0; i < nverts; i++) {
+        const Vertex &p = mVertices[i];
+        wpoints[i] = std::make_pair(Regular::Weighted_point(Regular::Bare_point(p[0],p[1]), _[i]), TypeIndex(i));
+    }
+
+    // (spatially sorted) insertion; points inside the power cells of others are hidden
+    Regular rt;
+    rt.insert(wpoints.begin(), wpoints.end());
+
+    this->topology_changed();
+    mFaces.clear();
+    for(auto iter = rt.finite_faces_begin(); iter != rt.finite_faces_end(); ++iter) {
+        mFaces.push_back(Face(iter->vertex(0)->info(), iter->vertex(1)->info(), iter->vertex(2)->info()));
+    }
+
+    // power cell areas (hidden vertices have none, and hull vertices are unbounded)
+    std::vector<TypeFunction> areas (nverts, 0);
+    for(auto iter = rt.finite_vertices_begin(); iter != rt.finite_vertices_end(); ++iter) {
+        const double a = power_cell_area(rt, iter);
+        areas[iter->info()] = std::isinf(a) ? std::numeric_limits<TypeFunction>::quiet_NaN() : a;
+    }
+    mFields["area_power"] = areas;
+    stamp("area_power");
+
+    if (verbose)
+        std::cout << " Done! created " << mFaces.size() << " triangles using " << rt.number_of_vertices()
+                  << " vertices (" << nverts - rt.number_of_vertices() << " hidden)!\n";
+
+    return get_faces();
+#endif
+}
+
+//! the periodic variant triangulates the points together with their periodic
+//! copies in a layer around the box (cgal has no periodic regular triangulation
+//! in 2D), and keeps the faces with at least one original vertex, i.e., the same
+//! faces as the 9-sheeted covering of periodicDelaunay
+std::vector<TypeIndexI> TriMesh::periodicRegular(float *_, int n, bool verbose) {
+
+#ifndef CGAL_AVAILABLE
+    std::cerr << " ERROR: " << this->tag() << "::periodicRegular - CGAL not available! cannot compute regular triangulation!\n";
+    return std::vector<TypeIndexI>();
+#else
+
+    if (this->mDim != 2) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::periodicRegular() requires a mesh in 2D!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (size_t(n) != this->mVertices.size() || n == 0) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::periodicRegular(): expected " << mVertices.size() << " weights, got " << n << "!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    typedef CGAL::Regular_triangulation_vertex_base_2<Kernel> Vb;
+    typedef CGAL::Triangulation_vertex_base_with_info_2<TypeIndex, Kernel, Vb> Vb_with_idx;
+    typedef CGAL::Regular_triangulation_face_base_2<Kernel> Fb;
+    typedef CGAL::Triangulation_data_structure_2<Vb_with_idx, Fb> Tds;
+    typedef CGAL::Regular_triangulation_2<Kernel, Tds> Regular;
+
+    if (verbose) {
+        std::cout << "   > " << this->tag() << "::periodicRegular()...";
+        fflush(stdout);
+    }
+
+    this->wrap_vertices();
+
+    const size_t nverts = this->mVertices.size();
+    const Vertex boxw = mBox1 - mBox0;
+
+    // the layer should contain all power centers of the faces of the original
+    // points: a few times the mean spacing, plus the largest radius
+    TypeFunction maxw = 0;
+    for(int i = 0; i < n; i++)
+        maxw = std::max(maxw, _[i]);
+
+    const double spacing = std::sqrt(double(boxw[0])*double(boxw[1]) / double(nverts));
+    const double layer = std::min(0.5*std::min(boxw[0], boxw[1]), 6.0*spacing + 2.0*std::sqrt(maxw));
+
+    // the original points and their copies (info = index into copies)
+    std::vector<periodicVertex> copies;
+    std::vector<std::pair<Regular::Weighted_point, TypeIndex>> wpoints;
+    copies.reserve(2*nverts);
+    wpoints.reserve(2*nverts);
+
+    for(size_t i = 0; i < nverts; i++) {
+    for(int ox = -1; ox <= 1; ox++) {
+    for(int oy = -1; oy <= 1; oy++) {
+
+        const double x = mVertices[i][0] + ox*boxw[0];
+        const double y = mVertices[i][1] + oy*boxw[1];
+        if ((ox != 0 || oy != 0) &&
+            (x < mBox0[0]-layer || x > mBox1[0]+layer || y < mBox0[1]-layer || y > mBox1[1]+layer))
+            continue;
+
+        wpoints.push_back(std::make_pair(Regular::Weighted_point(Regular::Bare_point(x,y), _[i]), TypeIndex(copies.size())));
+        copies.push_back(periodicVertex(TypeIndex(i), ox, oy));
+    }}}
+
+    Regular rt;
+    rt.insert(wpoints.begin(), wpoints.end());
+
+    // store the raw faces, and the power cells of the original points
+    this->mDelaunayFaces.clear();
+    std::vector<periodicVertex> delFace (3);
+
+    for(auto iter = rt.finite_faces_begin(); iter != rt.finite_faces_end(); ++iter) {
+
+        uint8_t num_orig_verts = 0;
+        for(uint8_t vid = 0; vid < 3; vid++) {
+            delFace[vid] = copies[iter->vertex(vid)->info()];
+            if (std::get<1>(delFace[vid]) == 0 && std::get<2>(delFace[vid]) == 0)
+                num_orig_verts++;
+        }
+        if (num_orig_verts > 0) {
+            this->mDelaunayFaces.push_back(delFace);
+        }
+    }
+
+    size_t nhidden = nverts;
+    std::vector<TypeFunction> areas (nverts, 0);
+    for(auto iter = rt.finite_vertices_begin(); iter != rt.finite_vertices_end(); ++iter) {
+        const periodicVertex &pv = copies[iter->info()];
+        if (std::get<1>(pv) != 0 || std::get<2>(pv) != 0)
+            continue;
+        areas[std::get<0>(pv)] = power_cell_area(rt, iter);
+        nhidden--;
+    }
+
+    if (verbose){
+        std::cout << " Done! created " << mDelaunayFaces.size() << " triangles using " << wpoints.size()
+                  << " points (" << nhidden << " hidden)!\n";
+    }
+    trim_periodicDelaunay(verbose);
+
+    mFields["area_power"] = areas;
+    stamp("area_power");
+    return get_faces();
+#endif
+}
+
+
 //! -----------------------------------------------------------------------------
 //! projection of points on the surface
 //! -----------------------------------------------------------------------------
@@ -350,16 +574,27 @@ std::vector<TypeFunction> TriMesh::distance_to_other_mesh(const TriMesh &other,
 
     // project the vertices of "this" mesh onto the "other" mesh
     // and compute the distances
+    //  (only the vertices in the region of interest, if any)
     const std::vector<Vertex> &points = this->mVertices;
-    const size_t npoints = points.size();
+    std::vector<TypeIndexI> ids;
+    if (this->has_roi()) {
+        ids = this->roi_vertices();
+    }
+    else {
+        ids.resize(points.size());
+        for(size_t i = 0; i < ids.size(); i++)
+            ids[i] = TypeIndexI(i);
+    }
+    const size_t npoints = ids.size();
 
     std::vector<Point3> cgalPoints (npoints);
     for(size_t i = 0; i < npoints; i++) {
-        cgalPoints[i] = Point3(points[i][0], points[i][1], points[i][2]);
+        const Vertex &p = points[ids[i]];
+        cgalPoints[i] = Point3(p[0], p[1], p[2]);
     }
 
     std::vector<TypeFunction> projections = other.project_on_surface(cgalPoints, verbose);
-    std::vector<TypeFunction> d (npoints, 0.0);
+    std::vector<TypeFunction> d (points.size(), this->has_roi() ? NAN : 0.0);
     for(size_t i = 0; i < npoints; i++) {
 
         // compute the projected point
@@ -372,7 +607,7 @@ std::vector<TypeFunction> TriMesh::distance_to_other_mesh(const TriMesh &other,
             p += w * other.mVertices[f[j]];
         }
 
-        d[i] = dist(p, points[i]);
+        d[ids[i]] = dist(p, points[ids[i]]);
     }
     return d;
 #endif
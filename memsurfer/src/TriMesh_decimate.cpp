@@ -0,0 +1,395 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <queue>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "TriMesh.hpp"
+
+/// -----------------------------------------------------------------------------
+//! quadric error metric (Garland and Heckbert, 1997)
+//!     Q(p) = p^T A p + 2 b.p + c, stored as the upper triangle of the 4x4 matrix
+/// -----------------------------------------------------------------------------
+struct Quadric {
+
+    double q[10];   // a00 a01 a02 b0 a11 a12 b1 a22 b2 c
+
+    Quadric() {     std::fill(q, q+10, 0.0);    }
+
+    //! plane n.p + d = 0 (n is unit)
+    void add_plane(const double n[3], const double d) {
+        q[0] += n[0]*n[0];  q[1] += n[0]*n[1];  q[2] += n[0]*n[2];  q[3] += n[0]*d;
+        q[4] += n[1]*n[1];  q[5] += n[1]*n[2];  q[6] += n[1]*d;
+        q[7] += n[2]*n[2];  q[8] += n[2]*d;
+        q[9] += d*d;
+    }
+
+    Quadric& operator+=(const Quadric &o) {
+        for(uint8_t i = 0; i < 10; i++)
+            q[i] += o.q[i];
+        return *this;
+    }
+
+    double operator()(const double p[3]) const {
+        return        q[0]*p[0]*p[0] + 2*q[1]*p[0]*p[1] + 2*q[2]*p[0]*p[2] + 2*q[3]*p[0]
+                    + q[4]*p[1]*p[1] + 2*q[5]*p[1]*p[2] + 2*q[6]*p[1]
+                    + q[7]*p[2]*p[2] + 2*q[8]*p[2]
+                    + q[9];
+    }
+
+    //! the minimizer (solves A p = -b); false if A is (nearly) singular
+    bool optimize(double p[3]) const {
+
+        const double a00 = q[0], a01 = q[1], a02 = q[2];
+        const double a11 = q[4], a12 = q[5], a22 = q[7];
+
+        const double c00 = a11*a22 - a12*a12;
+        const double c01 = a02*a12 - a01*a22;
+        const double c02 = a01*a12 - a02*a11;
+        const double det = a00*c00 + a01*c01 + a02*c02;
+
+        const double scale = std::max(1e-30, a00*a00 + a11*a11 + a22*a22);
+        if (std::fabs(det) < 1e-9*std::pow(scale, 1.5))
+            return false;
+
+        const double c11 = a00*a22 - a02*a02;
+        const double c12 = a01*a02 - a00*a12;
+        const double c22 = a00*a11 - a01*a01;
+
+        const double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+        p[0] = (c00*b0 + c01*b1 + c02*b2) / det;
+        p[1] = (c01*b0 + c11*b1 + c12*b2) / det;
+        p[2] = (c02*b0 + c12*b1 + c22*b2) / det;
+        return true;
+    }
+};
+
+/// -----------------------------------------------------------------------------
+//! a candidate collapse (remove vertex r, keep vertex k at position p)
+/// -----------------------------------------------------------------------------
+struct Collapse {
+    double cost;
+    TypeIndex k, r;
+    uint32_t kstamp, rstamp;
+    Vertex p;
+
+    bool operator>(const Collapse &o) const {   return cost > o.cost;   }
+};
+
+/// -----------------------------------------------------------------------------
+//! decimate the surface by quadric-error edge collapses
+/// -----------------------------------------------------------------------------
+size_t TriMesh::decimate(const size_t target_nverts, const TypeFunction max_error, bool verbose) {
+
+    if (this->mPeriodic) {
+        std::ostringstream errMsg;
+        errMsg << "   > " << this->tag() << "::decimate(): periodic meshes are not supported!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (target_nverts == 0 && max_error < 0) {
+        std::ostringstream errMsg;
+        errMsg << "   > " << this->tag() << "::decimate(): need a target number of vertices or a max error!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    const size_t nverts = mVertices.size();
+    const size_t nfaces = mFaces.size();
+
+    if (verbose) {
+        std::cout << "   > " << this->tag() << "::decimate(" << nverts << " verts, " << nfaces
+                  << " faces, target = " << target_nverts << ", max_error = " << max_error << ")...";
+        fflush(stdout);
+    }
+
+    // -------------------------------------------------------------------------
+    // connectivity
+    std::vector<std::vector<TypeIndex>> vfaces (nverts);
+    for(TypeIndex f = 0; f < nfaces; f++) {
+        for(uint8_t d = 0; d < 3; d++)
+            vfaces[mFaces[f][d]].push_back(f);
+    }
+
+    // boundary (and non-manifold) edges: their vertices are locked
+    std::unordered_map<uint64_t, uint8_t> ecount;
+    ecount.reserve(3*nfaces);
+    for(TypeIndex f = 0; f < nfaces; f++) {
+    for(uint8_t d = 0; d < 3; d++) {
+        TypeIndex a = mFaces[f][d], b = mFaces[f][(d+1)%3];
+        if (a > b) std::swap(a,b);
+        ecount[(uint64_t(a) << 32) | b]++;
+    }}
+
+    std::vector<bool> locked (nverts, false);
+    for(auto iter = ecount.begin(); iter != ecount.end(); iter++) {
+        if (iter->second != 2) {
+            locked[iter->first >> 32] = true;
+            locked[iter->first & 0xffffffff] = true;
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // quadrics of the face planes
+    std::vector<Quadric> quadrics (nverts);
+    for(TypeIndex f = 0; f < nfaces; f++) {
+
+        const Vertex &a = mVertices[mFaces[f][0]];
+        const Vertex &b = mVertices[mFaces[f][1]];
+        const Vertex &c = mVertices[mFaces[f][2]];
+
+        Vertex n = (b-a) CROSS (c-a);
+        const TypeFunction l = len(n);
+        if (l < 1e-20)
+            continue;
+
+        const double nd[3] = {n[0]/l, n[1]/l, n[2]/l};
+        const double d = -(nd[0]*a[0] + nd[1]*a[1] + nd[2]*a[2]);
+        for(uint8_t k = 0; k < 3; k++)
+            quadrics[mFaces[f][k]].add_plane(nd, d);
+    }
+
+    // -------------------------------------------------------------------------
+    std::vector<bool> valive (nverts, true);
+    std::vector<bool> falive (nfaces, true);
+    std::vector<uint32_t> stamps (nverts, 0);
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+    // the best collapse of edge (u,v)
+    auto candidate = [&](TypeIndex u, TypeIndex v) {
+
+        if (locked[u] && locked[v])
+            return;
+
+        // a locked vertex does not move
+        if (locked[u])
+            std::swap(u,v);
+
+        Quadric q = quadrics[u];
+        q += quadrics[v];
+
+        double p[3];
+        if (locked[v]) {
+            p[0] = mVertices[v][0];     p[1] = mVertices[v][1];     p[2] = mVertices[v][2];
+        }
+        else if (!q.optimize(p)) {
+
+            // choose the best of the end points and the mid point
+            const Vertex m = TypeFunction(0.5)*(mVertices[u] + mVertices[v]);
+            const Vertex *opts[3] = {&mVertices[u], &mVertices[v], &m};
+            double best = -1;
+            for(uint8_t i = 0; i < 3; i++) {
+                const double o[3] = {(*opts[i])[0], (*opts[i])[1], (*opts[i])[2]};
+                const double e = q(o);
+                if (best < 0 || e < best) {
+                    best = e;   p[0] = o[0];    p[1] = o[1];    p[2] = o[2];
+                }
+            }
+        }
+
+        Collapse c;
+        c.cost = std::max(0.0, q(p));
+        c.k = v;    c.kstamp = stamps[v];
+        c.r = u;    c.rstamp = stamps[u];
+        c.p = Vertex(p[0], p[1], p[2]);
+        heap.push(c);
+    };
+
+    for(auto iter = ecount.begin(); iter != ecount.end(); iter++) {
+        candidate(iter->first >> 32, iter->first & 0xffffffff);
+    }
+    ecount.clear();
+
+    // -------------------------------------------------------------------------
+    // check whether a collapse keeps the mesh manifold and does not flip faces
+    std::vector<TypeIndex> knbrs, rnbrs, opposite;
+
+    auto is_valid = [&](const Collapse &c) {
+
+        knbrs.clear();  rnbrs.clear();  opposite.clear();
+
+        for(auto f = vfaces[c.k].begin(); f != vfaces[c.k].end(); f++) {
+            const Face &face = mFaces[*f];
+            const bool shared = (face[0] == c.r || face[1] == c.r || face[2] == c.r);
+            for(uint8_t d = 0; d < 3; d++) {
+                if (face[d] == c.k || face[d] == c.r)   continue;
+                knbrs.push_back(face[d]);
+                if (shared) opposite.push_back(face[d]);
+            }
+        }
+        for(auto f = vfaces[c.r].begin(); f != vfaces[c.r].end(); f++) {
+            const Face &face = mFaces[*f];
+            for(uint8_t d = 0; d < 3; d++) {
+                if (face[d] != c.k && face[d] != c.r)
+                    rnbrs.push_back(face[d]);
+            }
+        }
+
+        // link condition: common neighbors are only the vertices opposite to the edge
+        std::sort(knbrs.begin(), knbrs.end());      knbrs.erase(std::unique(knbrs.begin(), knbrs.end()), knbrs.end());
+        std::sort(rnbrs.begin(), rnbrs.end());      rnbrs.erase(std::unique(rnbrs.begin(), rnbrs.end()), rnbrs.end());
+        std::sort(opposite.begin(), opposite.end());
+
+        if (opposite.empty())
+            return false;
+
+        size_t ncommon = 0;
+        for(auto i = knbrs.begin(), j = rnbrs.begin(); i != knbrs.end() && j != rnbrs.end(); ) {
+            if (*i < *j)        i++;
+            else if (*j < *i)   j++;
+            else {
+                if (!std::binary_search(opposite.begin(), opposite.end(), *i))
+                    return false;
+                ncommon++;  i++;    j++;
+            }
+        }
+        if (ncommon != opposite.size())
+            return false;
+
+        // normals of the remaining faces should not flip (or degenerate)
+        for(uint8_t s = 0; s < 2; s++) {
+
+            const TypeIndex v = (s == 0) ? c.k : c.r;
+            for(auto f = vfaces[v].begin(); f != vfaces[v].end(); f++) {
+
+                const Face &face = mFaces[*f];
+                if ((face[0] == c.r || face[1] == c.r || face[2] == c.r) &&
+                    (face[0] == c.k || face[1] == c.k || face[2] == c.k))
+                    continue;
+
+                Vertex p[3];
+                for(uint8_t d = 0; d < 3; d++)
+                    p[d] = (face[d] == v) ? c.p : mVertices[face[d]];
+
+                const Vertex n0 = (mVertices[face[1]]-mVertices[face[0]]) CROSS (mVertices[face[2]]-mVertices[face[0]]);
+                const Vertex n1 = (p[1]-p[0]) CROSS (p[2]-p[0]);
+
+                const TypeFunction l0 = len(n0), l1 = len(n1);
+                if (l1 < 1e-12*std::max(TypeFunction(1), l0) || (n0 DOT n1) < 0.5*l0*l1)
+                    return false;
+            }
+        }
+        return true;
+    };
+
+    // -------------------------------------------------------------------------
+    // collapse edges in the order of increasing error
+    size_t nalive = nverts;
+    const double max_cost = (max_error < 0) ? -1 : double(max_error)*double(max_error);
+
+    while (!heap.empty() && nalive > std::max(target_nverts, size_t(4))) {
+
+        const Collapse c = heap.top();
+        heap.pop();
+
+        if (!valive[c.k] || !valive[c.r] || c.kstamp != stamps[c.k] || c.rstamp != stamps[c.r])
+            continue;
+
+        if (max_cost >= 0 && c.cost > max_cost)
+            break;
+
+        if (!is_valid(c))
+            continue;
+
+        // remove the faces on the edge, and move the faces of r to k
+        std::vector<TypeIndex> &kf = vfaces[c.k];
+        for(auto f = vfaces[c.r].begin(); f != vfaces[c.r].end(); f++) {
+
+            Face &face = mFaces[*f];
+            if (face[0] == c.k || face[1] == c.k || face[2] == c.k) {
+                falive[*f] = false;
+                for(uint8_t d = 0; d < 3; d++) {
+                    std::vector<TypeIndex> &vf = vfaces[face[d]];
+                    if (face[d] != c.r)
+                        vf.erase(std::remove(vf.begin(), vf.end(), *f), vf.end());
+                }
+            }
+            else {
+                for(uint8_t d = 0; d < 3; d++) {
+                    if (face[d] == c.r)     face[d] = c.k;
+                }
+                kf.push_back(*f);
+            }
+        }
+        vfaces[c.r].clear();
+
+        mVertices[c.k] = c.p;
+        quadrics[c.k] += quadrics[c.r];
+        valive[c.r] = false;
+        stamps[c.k]++;
+        nalive--;
+
+        // new candidates around k
+        knbrs.clear();
+        for(auto f = kf.begin(); f != kf.end(); f++) {
+            for(uint8_t d = 0; d < 3; d++) {
+                if (mFaces[*f][d] != c.k)   knbrs.push_back(mFaces[*f][d]);
+            }
+        }
+        std::sort(knbrs.begin(), knbrs.end());
+        knbrs.erase(std::unique(knbrs.begin(), knbrs.end()), knbrs.end());
+
+        const std::vector<TypeIndex> nbrs = knbrs;
+        for(auto n = nbrs.begin(); n != nbrs.end(); n++)
+            candidate(c.k, *n);
+    }
+
+    // -------------------------------------------------------------------------
+    // compact the vertices and faces
+    std::vector<TypeIndex> vmap (nverts, 0);
+    std::vector<Vertex> vertices;
+    vertices.reserve(nalive);
+    for(TypeIndex i = 0; i < nverts; i++) {
+        if (!valive[i])     continue;
+        vmap[i] = vertices.size();
+        vertices.push_back(mVertices[i]);
+    }
+
+    std::vector<Face> faces;
+    faces.reserve(nfaces);
+    for(TypeIndex f = 0; f < nfaces; f++) {
+        if (!falive[f])     continue;
+        const Face &face = mFaces[f];
+        faces.push_back(Face(vmap[face[0]], vmap[face[1]], vmap[face[2]]));
+    }
+
+    mVertices.swap(vertices);
+    mFaces.swap(faces);
+    this->geometry_changed();
+    this->topology_changed();
+
+    // everything computed on the old mesh is invalid
+    mStamps.clear();
+    mFields.clear();
+    mPointNormals.clear();
+    mFaceNormals.clear();
+    mgeodesics.clear();
+    mVNeighbors.clear();
+    mVAdjFaces.clear();
+    mFAcrossEdge.clear();
+    bedges.clear();
+
+    if (verbose) {
+        std::cout << " Done! created " << mVertices.size() << " vertices and " << mFaces.size() << " faces!\n";
+    }
+    return mVertices.size();
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
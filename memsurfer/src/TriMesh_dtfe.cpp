@@ -0,0 +1,302 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TriMesh.hpp"
+#include "Periodic.hpp"
+
+/// -----------------------------------------------------------------------------
+//! Delaunay tessellation field estimator (Schaap and van de Weygaert, 2000)
+//!     the density at vertex i is (D+1) m_i / A_i, where A_i is the area of the
+//!     star of i (its contiguous Voronoi cell), and m_i = 1.
+//!     the density of a subset of the vertices (species) is estimated on the
+//!     Delaunay triangulation (in xy) of the subset itself, and interpolated
+//!     linearly onto all vertices (nan outside the subset, if not periodic)
+/// -----------------------------------------------------------------------------
+
+void TriMesh::dtfe(const std::vector<TypeIndexI> &ids, std::vector<TypeFunction> &density) const {
+
+    if (this->mPeriodic && !this->bbox_valid) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::dtfe(): Bounding box not available!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    const size_t nverts = this->mVertices.size();
+
+    if (!ids.empty()) {
+
+        // the species (a vertex listed k times has mass k)
+        std::vector<TypeIndexI> sids (ids);
+        std::sort(sids.begin(), sids.end());
+        for(auto iter = sids.begin(); iter != sids.end(); iter++) {
+            if (*iter < 0 || size_t(*iter) >= nverts) {
+                std::ostringstream errMsg;
+                errMsg << " " << this->tag() << "::dtfe(): Invalid vertex " << *iter << " (of " << nverts << ")!" << std::endl;
+                throw std::invalid_argument(errMsg.str());
+            }
+        }
+
+        std::vector<TypeFunction> mass;
+        std::vector<TypeIndexI> uids;
+        for(auto iter = sids.begin(); iter != sids.end(); iter++) {
+            if (uids.empty() || uids.back() != *iter) {
+                uids.push_back(*iter);
+                mass.push_back(0);
+            }
+            mass.back() += 1;
+        }
+        if (uids.size() < 3) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::dtfe(): Need at least 3 vertices to triangulate (got " << uids.size() << ")!" << std::endl;
+            throw std::invalid_argument(errMsg.str());
+        }
+
+        // triangulate the species in xy
+        const size_t nspecies = uids.size();
+        TriMesh planar;
+        planar.mDim = 2;
+        planar.mPeriodic = this->mPeriodic;
+        planar.bbox_valid = this->bbox_valid;
+        planar.mBox0 = Vertex(this->mBox0[0], this->mBox0[1], 0);
+        planar.mBox1 = Vertex(this->mBox1[0], this->mBox1[1], 0);
+        planar.mVertices.resize(nspecies);
+        for(size_t i = 0; i < nspecies; i++) {
+            const Vertex &v = this->mVertices[uids[i]];
+            planar.mVertices[i] = Vertex(v[0], v[1], 0);
+        }
+        planar.delaunay();
+
+        // and estimate its density on the (possibly wrapped) species
+        TriMesh species;
+        species.mDim = this->mDim;
+        species.mPeriodic = this->mPeriodic;
+        species.bbox_valid = this->bbox_valid;
+        species.mBox0 = this->mBox0;
+        species.mBox1 = this->mBox1;
+        species.mVertices.resize(nspecies);
+        for(size_t i = 0; i < nspecies; i++) {
+            const Vertex &v = planar.mVertices[i];
+            species.mVertices[i] = Vertex(v[0], v[1], this->mVertices[uids[i]][2]);
+        }
+        species.mFaces.swap(planar.mFaces);
+        species.mPeriodicFaces.swap(planar.mPeriodicFaces);
+
+        std::vector<TypeFunction> &sdensity = species.mFields["dtfe"];
+        species.dtfe(std::vector<TypeIndexI>(), sdensity);
+        for(size_t i = 0; i < nspecies; i++)
+            sdensity[i] *= mass[i];
+        species.stamp("dtfe");
+
+        std::vector<float> points (2*nverts);
+        for(size_t i = 0; i < nverts; i++) {
+            points[2*i] = this->mVertices[i][0];
+            points[2*i+1] = this->mVertices[i][1];
+        }
+        const std::vector<TypeFunction> values = species.interpolate_field("dtfe", points.data(), int(nverts), 2);
+        Numa::assign(density, nverts, TypeFunction(0));
+        std::copy(values.begin(), values.end(), density.begin());
+        return;
+    }
+
+    if (this->mFaces.empty()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::dtfe(): Mesh has no faces!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    const Vertex boxw = this->mBox1 - this->mBox0;
+
+    // area of the star of every vertex (one pass over the faces)
+    std::vector<TypeFunction> stars (nverts, 0);
+
+    std::vector<const std::vector<Face>*> faces (1, &this->mFaces);
+    if (this->mPeriodic)
+        faces.push_back(&this->mPeriodicFaces);
+
+    for(auto fiter = faces.begin(); fiter != faces.end(); fiter++) {
+
+        const std::vector<Face> &fcs = **fiter;
+        const TypeIndexI nfaces = TypeIndexI(fcs.size());
+
+        #pragma omp parallel for
+        for(TypeIndexI i = 0; i < nfaces; i++) {
+
+            Vertex p[3];
+            unwrap_face(fcs[i], this->mVertices, this->mPeriodic, boxw, p);
+
+            const TypeFunction area = 0.5 * len((p[1]-p[0]) CROSS (p[2]-p[0]));
+            for(uint8_t k = 0; k < 3; k++) {
+                #pragma omp atomic
+                stars[fcs[i][k]] += area;
+            }
+        }
+    }
+
+    const TypeFunction dfactor = 3.0;      // D+1 for triangles
+    Numa::assign(density, nverts, TypeFunction(0));
+
+    #pragma omp parallel for
+    for(TypeIndexI i = 0; i < TypeIndexI(nverts); i++) {
+        if (stars[i] > 0)
+            density[i] = dfactor / stars[i];
+    }
+}
+
+/// -----------------------------------------------------------------------------
+//! linear interpolation of a vertex field at query points (in xy)
+/// -----------------------------------------------------------------------------
+
+std::vector<TypeFunction> TriMesh::interpolate_field(const std::string &name, float *_, int n, int d) const {
+
+    auto fiter = mFields.find(name);
+    if (fiter == mFields.end() || fiter->second.size() != mVertices.size()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::interpolate_field(" << name << "): Field not found!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (d < 2) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::interpolate_field(): Need 2D or 3D points (got " << d << "D)!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (this->mPeriodic && !this->bbox_valid) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::interpolate_field(): Bounding box not available!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    const std::vector<TypeFunction> &field = fiter->second;
+    const bool periodic = this->mPeriodic;
+    const Vertex boxw = this->mBox1 - this->mBox0;
+
+    // -------------------------------------------------------------------------
+    // collect the (unwrapped) faces
+    std::vector<Face> faces (this->mFaces);
+    if (periodic)
+        faces.insert(faces.end(), this->mPeriodicFaces.begin(), this->mPeriodicFaces.end());
+
+    const size_t nfaces = faces.size();
+    std::vector<Vertex> corners (3*nfaces);
+    for(size_t i = 0; i < nfaces; i++) {
+        unwrap_face(faces[i], this->mVertices, periodic, boxw, &corners[3*i]);
+    }
+
+    // -------------------------------------------------------------------------
+    // bin the faces into a uniform grid (over the box, or the extent of the vertices)
+    Vertex g0 = this->mBox0, gw = boxw;
+    if (!periodic) {
+        Vertex g1 = this->mVertices.front();
+        g0 = g1;
+        for(auto iter = mVertices.begin(); iter != mVertices.end(); iter++) {
+            g0.min(*iter);
+            g1.max(*iter);
+        }
+        gw = g1 - g0;
+    }
+
+    const int ng = std::max(1, int(std::sqrt(0.5*TypeFunction(nfaces))));
+    const TypeFunction cw[2] = {std::max(gw[0], TypeFunction(1e-6)) / ng, std::max(gw[1], TypeFunction(1e-6)) / ng};
+
+    auto cell = [&](const TypeFunction x, const uint8_t k) -> int {
+        return int(std::floor((x - g0[k]) / cw[k]));
+    };
+    auto wrap = [&](int c) -> int {
+        if (periodic)   return ((c % ng) + ng) % ng;
+        return std::min(std::max(c, 0), ng-1);
+    };
+
+    std::vector<TypeIndex> offsets (size_t(ng)*ng + 1, 0);
+    std::vector<TypeIndex> binned;
+
+    for(uint8_t pass = 0; pass < 2; pass++) {
+
+        std::vector<TypeIndex> fill;
+        if (pass == 1) {
+            for(size_t c = 0; c < size_t(ng)*ng; c++)
+                offsets[c+1] += offsets[c];
+            binned.resize(offsets.back());
+            fill.assign(offsets.begin(), offsets.end()-1);
+        }
+
+        for(size_t fidx = 0; fidx < nfaces; fidx++) {
+
+            const Vertex *p = &corners[3*fidx];
+            const int i0 = cell(std::min(p[0][0], std::min(p[1][0], p[2][0])), 0);
+            const int i1 = cell(std::max(p[0][0], std::max(p[1][0], p[2][0])), 0);
+            const int j0 = cell(std::min(p[0][1], std::min(p[1][1], p[2][1])), 1);
+            const int j1 = cell(std::max(p[0][1], std::max(p[1][1], p[2][1])), 1);
+
+            for(int cj = j0; cj <= j1; cj++) {
+            for(int ci = i0; ci <= i1; ci++) {
+                const size_t c = size_t(wrap(cj))*ng + wrap(ci);
+                if (pass == 0)      offsets[c+1]++;
+                else                binned[fill[c]++] = TypeIndex(fidx);
+            }}
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // locate and interpolate every query point
+    const TypeFunction eps = 1e-5;
+    std::vector<TypeFunction> values (n, NAN);
+
+    #pragma omp parallel for
+    for(TypeIndexI q = 0; q < n; q++) {
+
+        TypeFunction x = _[d*q], y = _[d*q+1];
+        if (periodic) {
+            x -= boxw[0] * std::floor((x - this->mBox0[0]) / boxw[0]);
+            y -= boxw[1] * std::floor((y - this->mBox0[1]) / boxw[1]);
+        }
+
+        const size_t c = size_t(wrap(cell(y, 1)))*ng + wrap(cell(x, 0));
+        for(TypeIndex b = offsets[c]; b < offsets[c+1]; b++) {
+
+            const TypeIndex fidx = binned[b];
+            const Vertex *p = &corners[3*fidx];
+
+            // the image of the query closest to this face
+            TypeFunction qx = x, qy = y;
+            if (periodic) {
+                qx += boxw[0] * std::round((p[0][0] - qx) / boxw[0]);
+                qy += boxw[1] * std::round((p[0][1] - qy) / boxw[1]);
+            }
+
+            const TypeFunction det = (p[1][1]-p[2][1])*(p[0][0]-p[2][0]) + (p[2][0]-p[1][0])*(p[0][1]-p[2][1]);
+            if (std::fabs(det) < 1e-12)
+                continue;
+
+            const TypeFunction w0 = ((p[1][1]-p[2][1])*(qx-p[2][0]) + (p[2][0]-p[1][0])*(qy-p[2][1])) / det;
+            const TypeFunction w1 = ((p[2][1]-p[0][1])*(qx-p[2][0]) + (p[0][0]-p[2][0])*(qy-p[2][1])) / det;
+            const TypeFunction w2 = 1.0 - w0 - w1;
+            if (w0 < -eps || w1 < -eps || w2 < -eps)
+                continue;
+
+            const Face &f = faces[fidx];
+            values[q] = w0*field[f[0]] + w1*field[f[1]] + w2*field[f[2]];
+            break;
+        }
+    }
+    return values;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
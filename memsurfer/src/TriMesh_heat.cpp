@@ -0,0 +1,163 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+#include "TriMesh.hpp"
+#include "SparseMatrix.hpp"
+
+/// -----------------------------------------------------------------------------
+//! the factorized diffusion operator (M + dt L) of a mesh
+//!     L is the cotangent Laplacian, and M the lumped mass (point areas)
+/// -----------------------------------------------------------------------------
+
+class HeatSolver {
+public:
+    TypeFunction dt;
+    std::vector<double> mass;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver;
+};
+
+//! the number of (backward Euler) steps of the diffusion
+//!     one step is a smoother kernel than the Gaussian (singular at the source);
+//!     a few steps (one back-solve each) are close to the Gaussian
+static const int HEAT_NSTEPS = 8;
+
+/// -----------------------------------------------------------------------------
+//! density as the diffusion of unit masses at the ids for time t = sigma^2 / 2
+//!     (M + dt L) u_{k+1} = M u_k, with dt = t / nsteps and M u_0 = masses of the ids
+//!     L is the (cached) cotangent Laplacian of the mesh (TriMesh_operators.cpp)
+//!     the factorization is cached (for the geometry and topology, and dt),
+//!     so every further density costs nsteps back-solves
+/// -----------------------------------------------------------------------------
+
+void TriMesh::kde_heat(const std::vector<TypeIndexI> &ids, const TypeFunction sigma,
+                       std::vector<TypeFunction> &density, bool verbose) {
+
+    if (!(sigma > 0)) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::kde_heat(): Invalid sigma (" << sigma << ")!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (this->mPeriodic && !this->bbox_valid) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::kde_heat(): Bounding box not available!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+    if (this->mFaces.empty()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::kde_heat(): Mesh has no faces!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    const size_t nverts = this->mVertices.size();
+    const TypeFunction dt = 0.5 * sigma * sigma / TypeFunction(HEAT_NSTEPS);
+
+    // -------------------------------------------------------------------------
+    // factorize (M + dt L) for the current mesh
+    if (!is_current("_heat") || !mHeat || mHeat->dt != dt) {
+
+        if (verbose) {
+            std::cout << "   > " << tag() << "::kde_heat(): factorizing diffusion operator...";
+            fflush(stdout);
+        }
+
+        const std::vector<TypeFunction> &areas = this->need_pointareas();
+        const SparseMatrix &L = this->need_operator(OP_LAPLACIAN);
+
+        std::shared_ptr<HeatSolver> heat = std::make_shared<HeatSolver>();
+        heat->dt = dt;
+        heat->mass.assign(areas.begin(), areas.end());
+
+        std::vector<Eigen::Triplet<double>> triplets;
+        triplets.reserve(L.nnz() + nverts);
+        for(size_t r = 0; r < nverts; r++) {
+        for(size_t k = L.offsets()[r]; k < L.offsets()[r+1]; k++) {
+            triplets.push_back(Eigen::Triplet<double>(r, L.columns()[k], dt*L.values()[k]));
+        }}
+        for(size_t i = 0; i < nverts; i++) {
+            triplets.push_back(Eigen::Triplet<double>(i, i, heat->mass[i]));
+        }
+
+        Eigen::SparseMatrix<double> A (nverts, nverts);
+        A.setFromTriplets(triplets.begin(), triplets.end());
+
+        heat->solver.compute(A);
+        if (heat->solver.info() != Eigen::Success) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::kde_heat(): Failed to factorize the diffusion operator!" << std::endl;
+            throw std::runtime_error(errMsg.str());
+        }
+
+        this->mHeat = heat;
+        stamp("_heat");
+
+        if (verbose)
+            std::cout << " Done!\n";
+    }
+
+    // -------------------------------------------------------------------------
+    // unit masses at the ids (all vertices if none)
+    Eigen::VectorXd u = Eigen::VectorXd::Zero(nverts);
+    if (ids.empty()) {
+        u.setOnes();
+    }
+    else {
+        for(auto iter = ids.begin(); iter != ids.end(); iter++)
+            u[*iter] += 1;
+    }
+
+    // diffuse: every step solves for the density, and the next rhs is its mass
+    const HeatSolver &heat = *this->mHeat;
+    for(int s = 0; s < HEAT_NSTEPS; s++) {
+        if (s > 0) {
+            for(size_t i = 0; i < nverts; i++)
+                u[i] *= heat.mass[i];
+        }
+        u = heat.solver.solve(u);
+    }
+
+    Numa::assign(density, nverts, TypeFunction(0));
+    for(size_t i = 0; i < nverts; i++) {
+        density[i] = TypeFunction(u[i]);
+    }
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+
+size_t TriMesh::heat_memory_usage() const {
+
+    if (!this->mHeat)
+        return 0;
+
+    // the factor L (D is a vector), and the fill-reducing permutation
+    const HeatSolver &heat = *this->mHeat;
+    const size_t n = heat.mass.size();
+    const size_t nnz = heat.solver.matrixL().nestedExpression().nonZeros();
+
+    return heat.mass.capacity()*sizeof(double) +
+           nnz*(sizeof(double)+sizeof(int)) + (n+1)*sizeof(int) +
+           n*(sizeof(double) + 2*sizeof(int));
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
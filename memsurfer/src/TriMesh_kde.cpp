@@ -13,6 +13,8 @@ For details, see https://github.com/LLNL/MemSurfer.
 /// ----------------------------------------------------------------------------
 
 #include <map>
+#include <cmath>
+#include <cfloat>
 #include <sstream>
 #include <stdexcept>
 #include <chrono>
@@ -20,6 +22,8 @@ For details, see https://github.com/LLNL/MemSurfer.
 #include "TriMesh.hpp"
 #include "DensityKernels.hpp"
 #include "DistanceKernels.hpp"
+#include "KDTree.hpp"
+#include "CellList.hpp"
 
 #ifdef PDIST
 size_t square_to_condensed(const size_t &i, const size_t &j, const size_t &n) {
@@ -209,11 +213,12 @@ void TriMesh::compute_geodesics_fw(const std::vector<Vertex> &mvertices, const s
 
 #ifdef PDIST
     const size_t npairs = nverts*(nverts-1)/2;
-    distances.resize(npairs, FLT_MAX);
+    Numa::assign(distances, npairs, TypeFunction(FLT_MAX));
 #else
     distances.resize(nverts);
+    #pragma omp parallel for schedule(static) if(Numa::first_touch())
     for(size_t i = 0; i < nverts; i++)
-        distances[i].resize(nverts, FLT_MAX);
+        distances[i].assign(nverts, FLT_MAX);
 #endif
 
     if (verbose) {
@@ -343,22 +348,28 @@ void TriMesh::compute_geodesics_fw(const std::vector<Vertex> &mvertices, const s
 
 void
 kde_2d(const std::vector<Vertex> &vertices, const std::vector<TypeIndexI> &ids,
+       const std::vector<TypeIndexI> &targets,
        const DensityKernel& k, const DistanceKernel &dist,
        std::vector<TypeFunction> &density) {
 
     const size_t nids = ids.size();
     const size_t nverts = vertices.size();
-    density.resize(nverts, 0);
+    Numa::assign(density, nverts, TypeFunction(0));
+
+    // evaluate at the targets (e.g., a region of interest), or all vertices
+    const size_t ntargets = targets.empty() ? nverts : targets.size();
 
     if (nids == 0) {  // compute for all ids
-        for (TypeIndex j=0; j<nverts; j++) {
+        for (size_t t=0; t<ntargets; t++) {
+        const TypeIndex j = targets.empty() ? TypeIndex(t) : TypeIndex(targets[t]);
         for (TypeIndex i=0; i<nverts; i++) {
             density[j] += k(dist(vertices[i][0], vertices[i][1],
                                  vertices[j][0], vertices[j][1]));
         }}
     }
     else {              // compute for selected ids
-        for (TypeIndex j=0; j<nverts; j++) {
+        for (size_t t=0; t<ntargets; t++) {
+        const TypeIndex j = targets.empty() ? TypeIndex(t) : TypeIndex(targets[t]);
         for (TypeIndex i=0; i<nids;   i++) {
             density[j] += k(dist(vertices[ids[i]][0], vertices[ids[i]][1],
                                  vertices[j][0],      vertices[j][1]));
@@ -368,22 +379,28 @@ kde_2d(const std::vector<Vertex> &vertices, const std::vector<TypeIndexI> &ids,
 
 void
 kde_3d(const std::vector<Vertex> &vertices, const std::vector<TypeIndexI> &ids,
+       const std::vector<TypeIndexI> &targets,
        const DensityKernel& k, const DistanceKernel &dist,
        std::vector<TypeFunction> &density) {
 
     const size_t nids = ids.size();
     const size_t nverts = vertices.size();
-    density.resize(nverts, 0);
+    Numa::assign(density, nverts, TypeFunction(0));
+
+    // evaluate at the targets (e.g., a region of interest), or all vertices
+    const size_t ntargets = targets.empty() ? nverts : targets.size();
 
     if (nids == 0) {  // compute for all ids
-        for (TypeIndex j=0; j<nverts; j++) {
+        for (size_t t=0; t<ntargets; t++) {
+        const TypeIndex j = targets.empty() ? TypeIndex(t) : TypeIndex(targets[t]);
         for (TypeIndex i=0; i<nverts; i++) {
             density[j] += k(dist(vertices[i][0], vertices[i][1], vertices[i][2],
                                  vertices[j][0], vertices[j][1], vertices[j][2]));
         }}
     }
     else {              // compute for selected ids
-        for (TypeIndex j=0; j<nverts; j++) {
+        for (size_t t=0; t<ntargets; t++) {
+        const TypeIndex j = targets.empty() ? TypeIndex(t) : TypeIndex(targets[t]);
         for (TypeIndex i=0; i<nids;   i++) {
             density[j] += k(dist(vertices[ids[i]][0], vertices[ids[i]][1], vertices[ids[i]][2],
                                  vertices[j][0],      vertices[j][1],      vertices[j][2]));
@@ -391,6 +408,221 @@ kde_3d(const std::vector<Vertex> &vertices, const std::vector<TypeIndexI> &ids,
     }
 }
 
+/// -----------------------------------------------------------------------------
+//! dual-tree density estimation with a relative error tolerance
+//!     targets (all vertices, or the given ones) and sources (ids, or all vertices) are organized
+//!     in k-d trees. for every target leaf, the source tree is traversed
+//!     (nearer child first) and a source node S is approximated by
+//!     |S| (kmax + kmin) / 2, where [kmin, kmax] bound the kernel over all
+//!     pairs of points in the two boxes, as soon as
+//!         (kmax - kmin) <= 2 tol L / Ns
+//!     L is a running lower bound on the density of the targets in the leaf,
+//!     and Ns is the number of sources. the errors of all approximated nodes
+//!     sum to at most tol * L, i.e., the relative error is bounded by tol.
+//!     assumes the density kernel is monotonically decreasing in distance
+/// -----------------------------------------------------------------------------
+struct KDEDualTree {
+
+    const std::vector<Vertex> &vertices;
+    const DensityKernel &k;
+    const DistanceKernel &dist;
+    const uint8_t dim;
+    const TypeFunction tol;
+
+    const KDTree &ttree;
+    const KDTree &stree;
+
+    KDEDualTree(const std::vector<Vertex> &_vertices, const DensityKernel &_k,
+                const DistanceKernel &_dist, const uint8_t _dim, const TypeFunction _tol,
+                const KDTree &_ttree, const KDTree &_stree) :
+        vertices(_vertices), k(_k), dist(_dist), dim(_dim), tol(_tol),
+        ttree(_ttree), stree(_stree) {}
+
+    TypeFunction pdist(const TypeIndex a, const TypeIndex b) const {
+        const Vertex &va = vertices[a];
+        const Vertex &vb = vertices[b];
+        return (dim == 2) ? dist(va[0], va[1], vb[0], vb[1]) :
+                            dist(va[0], va[1], va[2], vb[0], vb[1], vb[2]);
+    }
+
+    //! traverse the source tree for the target leaf t
+    //!     exact contributions go to tsum (per target), approximated ones to shared
+    void traverse(const KDTree::Node &t, const TypeIndexI sidx, const double kroot, const double ns,
+                  std::vector<double> &tsum, double &shared, double &lbound) const {
+
+        const KDTree::Node &s = stree.mNodes[sidx];
+
+        TypeFunction dmin2, dmax2;
+        dist.box_bounds(t.bmin, t.bmax, s.bmin, s.bmax, dim, dmin2, dmax2);
+
+        const double kmax = k(dmin2);
+        const double kmin = k(dmax2);
+
+        // approximate the whole node
+        if (kmax - kmin <= 2.0*tol*lbound/ns) {
+            shared += 0.5*s.size()*(kmax + kmin);
+            lbound += s.size()*(kmin - kroot);
+            return;
+        }
+
+        // base case: exact
+        if (s.is_leaf()) {
+
+            double cmin = DBL_MAX;
+            for(TypeIndex j = t.begin; j < t.end; j++) {
+
+                const TypeIndex tj = ttree.mIndex[j];
+                double c = 0;
+                for(TypeIndex i = s.begin; i < s.end; i++) {
+                    c += k(pdist(stree.mIndex[i], tj));
+                }
+                tsum[j-t.begin] += c;
+                cmin = std::min(cmin, c);
+            }
+            lbound += cmin - s.size()*kroot;
+            return;
+        }
+
+        // recurse (nearer child first, to tighten the lower bound quickly)
+        TypeFunction l0, l1, u;
+        dist.box_bounds(t.bmin, t.bmax, stree.mNodes[s.left].bmin, stree.mNodes[s.left].bmax, dim, l0, u);
+        dist.box_bounds(t.bmin, t.bmax, stree.mNodes[s.right].bmin, stree.mNodes[s.right].bmax, dim, l1, u);
+
+        const TypeIndexI first = (l0 <= l1) ? s.left : s.right;
+        const TypeIndexI second = (l0 <= l1) ? s.right : s.left;
+        traverse(t, first, kroot, ns, tsum, shared, lbound);
+        traverse(t, second, kroot, ns, tsum, shared, lbound);
+    }
+};
+
+void
+kde_tree(const std::vector<Vertex> &vertices, const std::vector<TypeIndexI> &ids,
+         const std::vector<TypeIndexI> &targets,
+         const DensityKernel& k, const DistanceKernel &dist, const uint8_t dim,
+         const TypeFunction tol, std::vector<TypeFunction> &density) {
+
+    const size_t nverts = vertices.size();
+    Numa::assign(density, nverts, TypeFunction(0));
+
+    const KDTree ttree(vertices, targets, dim);
+    const KDTree stree(vertices, ids, dim);
+    if (ttree.mNodes.empty() || stree.mNodes.empty())
+        return;
+
+    std::vector<TypeIndexI> tleaves;
+    for(TypeIndex i = 0; i < ttree.mNodes.size(); i++) {
+        if (ttree.mNodes[i].is_leaf())
+            tleaves.push_back(i);
+    }
+
+    const KDEDualTree kdt(vertices, k, dist, dim, tol, ttree, stree);
+    const double ns = stree.mIndex.size();
+    const KDTree::Node &sroot = stree.mNodes[0];
+
+    #pragma omp parallel for schedule(dynamic)
+    for(TypeIndexI l = 0; l < TypeIndexI(tleaves.size()); l++) {
+
+        const KDTree::Node &t = ttree.mNodes[tleaves[l]];
+
+        // the lower bound starts from the farthest possible source
+        TypeFunction dmin2, dmax2;
+        dist.box_bounds(t.bmin, t.bmax, sroot.bmin, sroot.bmax, dim, dmin2, dmax2);
+        const double kroot = k(dmax2);
+
+        std::vector<double> tsum(t.size(), 0);
+        double shared = 0;
+        double lbound = ns*kroot;
+
+        kdt.traverse(t, 0, kroot, ns, tsum, shared, lbound);
+
+        for(TypeIndex j = t.begin; j < t.end; j++) {
+            density[ttree.mIndex[j]] = tsum[j-t.begin] + shared;
+        }
+    }
+}
+
+/// -----------------------------------------------------------------------------
+//! adaptive (Abramson-style) density estimation
+//!     the bandwidth of every source s is scaled by
+//!         lambda_s = d_k(s) / g,   g = geometric mean of d_k
+//!     where d_k(s) is the distance to the k-th nearest source. the scaled kernel
+//!         lambda^-dim K(r^2 / lambda^2)
+//!     integrates to the same value as K, and is evaluated only within the
+//!     support of each source (where K > 1e-7 K(0)), at the targets (all
+//!     vertices, or the given ones)
+/// -----------------------------------------------------------------------------
+void
+kde_adaptive(const std::vector<Vertex> &vertices, const std::vector<TypeIndexI> &ids,
+             const std::vector<TypeIndexI> &targets,
+             const DensityKernel& k, const DistanceKernel &dist, const uint8_t dim,
+             const TypeIndex knn, std::vector<TypeFunction> &density) {
+
+    const size_t nverts = vertices.size();
+    Numa::assign(density, nverts, TypeFunction(0));
+
+    std::vector<TypeIndex> sources;
+    if (ids.empty()) {
+        sources.resize(nverts);
+        for(TypeIndex i = 0; i < nverts; i++)
+            sources[i] = i;
+    }
+    else {
+        sources.assign(ids.begin(), ids.end());
+    }
+
+    const size_t nsrcs = sources.size();
+    if (nsrcs == 0)
+        return;
+
+    // support of the (unscaled) kernel
+    const TypeFunction support = std::sqrt(k.support_squared(1e-7));
+
+    const CellList scells(vertices, ids, dist, dim, support);
+    const CellList tcells(vertices, targets, dist, dim, support);
+
+    // kNN distance of every source
+    std::vector<TypeFunction> dk (nsrcs, 0);
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(TypeIndexI i = 0; i < TypeIndexI(nsrcs); i++) {
+        dk[i] = scells.knn_distance(sources[i], knn, 0.5*support);
+    }
+
+    // geometric mean of kNN distances (guarding against coincident points)
+    const TypeFunction dmean = std::accumulate(dk.begin(), dk.end(), TypeFunction(0)) / TypeFunction(nsrcs);
+    const TypeFunction dfloor = std::max(TypeFunction(1e-6)*dmean, TypeFunction(FLT_MIN));
+
+    double lsum = 0;
+    for(size_t i = 0; i < nsrcs; i++) {
+        dk[i] = std::max(dk[i], dfloor);
+        lsum += std::log(double(dk[i]));
+    }
+    const double gmean = std::exp(lsum / double(nsrcs));
+
+    // scatter the scaled kernels
+    #pragma omp parallel
+    {
+    std::vector<std::pair<TypeIndex, TypeFunction>> nbrs;
+
+    #pragma omp for schedule(dynamic, 64)
+    for(TypeIndexI i = 0; i < TypeIndexI(nsrcs); i++) {
+
+        const TypeFunction lambda = dk[i] / gmean;
+        const TypeFunction lambda2 = lambda*lambda;
+        const TypeFunction scale = std::pow(lambda, -TypeFunction(dim));
+
+        tcells.radius(vertices[sources[i]], lambda*support, nbrs);
+        for(auto iter = nbrs.begin(); iter != nbrs.end(); iter++) {
+
+            const TypeFunction val = scale * k(iter->second / lambda2);
+
+            #pragma omp atomic
+            density[iter->first] += val;
+        }
+    }
+    }
+}
+
 void kde_2m(const size_t &nverts, const std::vector<TypeIndexI> &ids,
             const DensityKernel& k,
 #ifdef PDIST
@@ -402,7 +634,7 @@ void kde_2m(const size_t &nverts, const std::vector<TypeIndexI> &ids,
 
 
     const size_t nids = ids.size();
-    density.resize(nverts, 0);
+    Numa::assign(density, nverts, TypeFunction(0));
 
     static TypeFunction tmp;
 
@@ -443,16 +675,39 @@ void kde_2m(const size_t &nverts, const std::vector<TypeIndexI> &ids,
 const std::vector<TypeFunction>&
     TriMesh::kde(const std::string &name, const int type, const bool get_counts,
                  const DensityKernel& dens, const DistanceKernel& dist,
-                 const std::vector<TypeIndexI> &ids, const bool verbose) {
+                 const std::vector<TypeIndexI> &ids, const TypeFunction tolerance,
+                 const int knn, const bool verbose) {
 
-    if (type < 1 || type > 3) {
+    if (type < 1 || type > 5) {
+        std::ostringstream errMsg;
+        errMsg << "   > " << this->tag() << "::kde(" << type << ">): invalid density type (should be 1, 2, 3, 4, or 5)!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (tolerance < 0) {
+        std::ostringstream errMsg;
+        errMsg << "   > " << this->tag() << "::kde(" << tolerance << ">): invalid tolerance (should be non-negative)!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (knn < 0 || (knn > 0 && (type == 1 || type >= 4))) {
+        std::ostringstream errMsg;
+        errMsg << "   > " << this->tag() << "::kde(" << knn << ">): invalid knn (adaptive density needs knn > 0 and type 2 or 3)!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (knn > 0 && tolerance > 0) {
         std::ostringstream errMsg;
-        errMsg << "   > " << this->tag() << "::kde(" << type << ">): invalid density type (should be 1, 2, or 3)!\n";
+        errMsg << "   > " << this->tag() << "::kde(" << knn << ", " << tolerance << ">): adaptive density (knn > 0) is not available with a tolerance!\n";
         throw std::invalid_argument(errMsg.str());
     }
 
-    // this name already exists in the map!
-    if (mFields.find(name) != mFields.end()) {
+    // the counts are normalized by the sum over all vertices
+    if (get_counts && this->has_roi()) {
+        std::ostringstream errMsg;
+        errMsg << "   > " << this->tag() << "::kde(" << name << "): get_counts is not available with a region of interest!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    // this name already exists in the map (and the mesh has not changed since)!
+    if (is_current(name)) {
         if (verbose){
             std::cout << " " << this->tag() << "::kde("<<name<<") got an already used name. Returning existing field!\n";
         }
@@ -467,14 +722,33 @@ const std::vector<TypeFunction>&
     // we will be using this!
     std::vector<TypeFunction> &density = mFields[name];
 
+    // the region of interest (types 2 and 3 are evaluated only there)
+    const std::vector<TypeIndexI> &roi = need_roi();
+
     // now, compute the appropriate density!
-    if (type == 2) {      kde_2d(mVertices, ids, dens, dist, density); }
-    else if (type == 3){  kde_3d(mVertices, ids, dens, dist, density); }
+    //  (knn > 0 uses adaptive bandwidths)
+    //  (tolerance > 0 uses the error-controlled dual-tree approximation)
+    if (this->has_roi() && roi.empty()) {   Numa::assign(density, mVertices.size(), TypeFunction(NAN)); }
+    else if (type == 5) {
+        const GaussianKernel *gauss = dynamic_cast<const GaussianKernel*>(&dens);
+        if (gauss == nullptr) {
+            std::ostringstream errMsg;
+            errMsg << "   > " << this->tag() << "::kde(" << name << "): diffusion density (type 5) needs a Gaussian kernel!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+        kde_heat(ids, gauss->sigma(), density, verbose);
+    }
+    else if (type == 4) {                   dtfe(ids, density); }
+    else if (knn > 0) {                     kde_adaptive(mVertices, ids, roi, dens, dist, type, knn, density); }
+    else if (type == 2 && tolerance > 0) {  kde_tree(mVertices, ids, roi, dens, dist, 2, tolerance, density); }
+    else if (type == 3 && tolerance > 0) {  kde_tree(mVertices, ids, roi, dens, dist, 3, tolerance, density); }
+    else if (type == 2) {                   kde_2d(mVertices, ids, roi, dens, dist, density); }
+    else if (type == 3) {                   kde_3d(mVertices, ids, roi, dens, dist, density); }
 
     // geodesic density!
     else {
         // initialize the geodesic graph!
-        if (mgeodesics.empty()) {
+        if (!is_current("_geodesics")) {
           if (this->mPeriodic) {
             std::vector<Face> mfaces = this->mFaces;
             mfaces.insert(mfaces.end(), this->mPeriodicFaces.begin(), this->mPeriodicFaces.end());
@@ -483,6 +757,7 @@ const std::vector<TypeFunction>&
           else {
             compute_geodesics_fw(this->mVertices, this->mFaces, dist, this->mgeodesics, verbose);
           }
+          stamp("_geodesics");
         }
 
         kde_2m(this->mVertices.size(), ids, dens, this->mgeodesics, mFields[name]);
@@ -515,7 +790,11 @@ const std::vector<TypeFunction>&
     if (get_counts) {
 
       const size_t np = (ids.empty()) ? ng : ids.size();  // num of points counted
-      const TypeFunction dsm = std::accumulate(density.begin(), density.end(), TypeFunction(0));
+      // (nan, e.g., the species DTFE outside the species, does not count)
+      const TypeFunction dsm = std::accumulate(density.begin(), density.end(), TypeFunction(0),
+                                               [](const TypeFunction a, const TypeFunction v) {
+                                                   return std::isnan(v) ? a : a + v;
+                                               });
       const TypeFunction norm = (TypeFunction(np) / dsm);
 
       // now, do the normalization
@@ -523,8 +802,21 @@ const std::vector<TypeFunction>&
                      std::bind(std::multiplies<TypeFunction>(), std::placeholders::_1, norm));
     }
 
+    // -------------------------------------------------------------------------
+    // outside the region of interest, the density is not available
+    if (this->has_roi()) {
+        std::vector<uint8_t> inside (density.size(), 0);
+        for(auto iter = roi.begin(); iter != roi.end(); iter++)
+            inside[*iter] = 1;
+        for(size_t i = 0; i < density.size(); i++) {
+            if (!inside[i])
+                density[i] = NAN;
+        }
+    }
+
     // -------------------------------------------------------------------------
     // -------------------------------------------------------------------------
+    stamp(name, true);
     if(verbose){
         printf(" Done!\n");
     }
@@ -0,0 +1,115 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "TriMesh.hpp"
+#include "SparseMatrix.hpp"
+
+/// -----------------------------------------------------------------------------
+//! bytes held by (the capacity of) a buffer
+/// -----------------------------------------------------------------------------
+
+template <typename T>
+static inline size_t bytes(const std::vector<T> &v) {
+    return v.capacity()*sizeof(T);
+}
+
+template <typename T>
+static inline size_t bytes(const std::vector<std::vector<T>> &v) {
+    size_t b = v.capacity()*sizeof(std::vector<T>);
+    for(auto iter = v.begin(); iter != v.end(); iter++)
+        b += bytes(*iter);
+    return b;
+}
+
+//! free a buffer (clear keeps the capacity)
+template <typename T>
+static inline void release(std::vector<T> &v) {
+    std::vector<T>().swap(v);
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+
+size_t TriMesh::memory_usage(bool caches_only) const {
+
+    // the caches that are recomputed on request
+    size_t b = bytes(mVNeighbors) + bytes(mVAdjFaces) + bytes(mFAcrossEdge) + bytes(bedges) +
+               bytes(mgeodesics) + heat_memory_usage();
+
+    for(int op = 0; op < NOPERATORS; op++) {
+        if (!mOperators[op])
+            continue;
+        const SparseMatrix &A = *mOperators[op];
+        b += bytes(A.offsets()) + bytes(A.columns()) + bytes(A.values());
+    }
+
+    if (caches_only)
+        return b;
+
+    // the mesh, its periodic data, normals, and fields
+    b += bytes(mVertices) + bytes(mFaces) +
+         bytes(mDelaunayFaces) + bytes(mPeriodicFaces) + bytes(mTrimmedFaces) +
+         bytes(mDuplicateVertex_periodic) + bytes(mDuplicateVerts) +
+         bytes(mPointNormals) + bytes(mFaceNormals) +
+         bytes(mROICenters) + bytes(mROI);
+
+    for(auto iter = mFields.begin(); iter != mFields.end(); iter++)
+        b += iter->first.capacity() + bytes(iter->second);
+
+    return b;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+
+void TriMesh::release_caches() {
+
+    release(mVNeighbors);
+    release(mVAdjFaces);
+    release(mFAcrossEdge);
+    release(bedges);
+    release(mgeodesics);
+
+    // the operators and the heat solver may still be shared with copies of the mesh
+    mHeat.reset();
+    for(int op = 0; op < NOPERATORS; op++)
+        mOperators[op].reset();
+
+    // (the adjacency is recomputed when empty, the rest when stale)
+    mStamps.erase("_geodesics");
+    mStamps.erase("_heat");
+    for(auto iter = mStamps.begin(); iter != mStamps.end(); ) {
+        if (iter->first.compare(0, 4, "_op_") == 0)     iter = mStamps.erase(iter);
+        else                                            iter++;
+    }
+}
+
+void TriMesh::release_fields(const std::vector<std::string> &keep) {
+
+    for(auto iter = mFields.begin(); iter != mFields.end(); ) {
+        if (std::find(keep.begin(), keep.end(), iter->first) != keep.end()) {
+            iter++;
+            continue;
+        }
+        mStamps.erase(iter->first);
+        iter = mFields.erase(iter);
+    }
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
@@ -0,0 +1,246 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "TriMesh.hpp"
+#include "Periodic.hpp"
+#include "SparseMatrix.hpp"
+
+typedef SparseMatrix::Triplet Triplet;
+
+static const char* operator_names[] = {"laplacian", "mass_lumped", "mass", "gradient", "divergence"};
+
+/// -----------------------------------------------------------------------------
+//! the cotangent Laplacian (positive semi-definite)
+//!     the cotangent of the angle at corner k weighs the opposite edge (i,j)
+/// -----------------------------------------------------------------------------
+
+static void cotan_laplacian(const std::vector<Vertex> &vertices, const std::vector<Face> &faces,
+                            const bool periodic, const Vertex &boxw, std::vector<Triplet> &triplets) {
+
+    triplets.reserve(triplets.size() + 12*faces.size());
+    for(auto fiter = faces.begin(); fiter != faces.end(); fiter++) {
+
+        const Face &f = *fiter;
+        Vertex p[3];
+        unwrap_face(f, vertices, periodic, boxw, p);
+
+        const double area2 = len((p[1]-p[0]) CROSS (p[2]-p[0]));
+        if (area2 <= 0)
+            continue;
+
+        for(uint8_t k = 0; k < 3; k++) {
+
+            const uint8_t i = (k+1)%3, j = (k+2)%3;
+            const Vertex a = p[i]-p[k], b = p[j]-p[k];
+            const double w = 0.5 * double(a DOT b) / area2;
+
+            triplets.push_back(Triplet(f[i], f[j], -w));
+            triplets.push_back(Triplet(f[j], f[i], -w));
+            triplets.push_back(Triplet(f[i], f[i],  w));
+            triplets.push_back(Triplet(f[j], f[j],  w));
+        }
+    }
+}
+
+//! the consistent mass matrix: area/12 * [2 1 1; 1 2 1; 1 1 2] per face
+static void mass_matrix(const std::vector<Vertex> &vertices, const std::vector<Face> &faces,
+                        const bool periodic, const Vertex &boxw, std::vector<Triplet> &triplets) {
+
+    triplets.reserve(triplets.size() + 9*faces.size());
+    for(auto fiter = faces.begin(); fiter != faces.end(); fiter++) {
+
+        const Face &f = *fiter;
+        Vertex p[3];
+        unwrap_face(f, vertices, periodic, boxw, p);
+
+        const double area = 0.5 * len((p[1]-p[0]) CROSS (p[2]-p[0]));
+        for(uint8_t i = 0; i < 3; i++) {
+        for(uint8_t j = 0; j < 3; j++) {
+            triplets.push_back(Triplet(f[i], f[j], area * (i == j ? 2.0 : 1.0) / 12.0));
+        }}
+    }
+}
+
+//! the gradients of the (linear) hat functions of every face, grad phi_i = N x e_i / 2A,
+//!     e_i being the edge opposite to vertex i (counter-clockwise around the normal N)
+//!     scaled by s(area) for every face (e.g., 1 for the gradient)
+template <typename Scale>
+static void hat_gradients(const std::vector<Vertex> &vertices, const std::vector<Face> &faces,
+                          const bool periodic, const Vertex &boxw, const bool transpose,
+                          Scale s, std::vector<Triplet> &triplets) {
+
+    triplets.reserve(triplets.size() + 9*faces.size());
+    for(size_t fidx = 0; fidx < faces.size(); fidx++) {
+
+        const Face &f = faces[fidx];
+        Vertex p[3];
+        unwrap_face(f, vertices, periodic, boxw, p);
+
+        const Vertex n = (p[1]-p[0]) CROSS (p[2]-p[0]);
+        const double area2 = len(n);
+        if (area2 <= 0)
+            continue;
+
+        const Vertex N = n / TypeFunction(area2);
+        const double scale = s(0.5*area2) / area2;
+
+        for(uint8_t i = 0; i < 3; i++) {
+            const Vertex g = N CROSS (p[(i+2)%3] - p[(i+1)%3]);
+            for(uint8_t d = 0; d < 3; d++) {
+                const TypeIndex row = TypeIndex(3*fidx+d);
+                if (!transpose)     triplets.push_back(Triplet(row, f[i], scale*g[d]));
+                else                triplets.push_back(Triplet(f[i], row, scale*g[d]));
+            }
+        }
+    }
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+
+int TriMesh::operator_index(const std::string &name) const {
+
+    for(int op = 0; op < NOPERATORS; op++) {
+        if (name == operator_names[op])
+            return op;
+    }
+
+    std::ostringstream errMsg;
+    errMsg << " " << this->tag() << "::operator_index(): Invalid operator (" << name
+           << "). Should be laplacian, mass_lumped, mass, gradient, or divergence!" << std::endl;
+    throw std::invalid_argument(errMsg.str());
+}
+
+const SparseMatrix& TriMesh::need_operator(const int op, bool verbose) {
+
+    const std::string key = std::string("_op_") + operator_names[op];
+    if (is_current(key) && this->mOperators[op])
+        return *this->mOperators[op];
+
+    if (this->mPeriodic && !this->bbox_valid) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::need_operator(" << operator_names[op] << "): Bounding box not available!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+    if (this->mFaces.empty()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::need_operator(" << operator_names[op] << "): Mesh has no faces!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    if (verbose) {
+        std::cout << "   > " << tag() << "::need_operator(" << operator_names[op] << ")...";
+        fflush(stdout);
+    }
+
+    const size_t nverts = this->mVertices.size();
+    const Vertex boxw = this->mBox1 - this->mBox0;
+
+    std::vector<Face> faces (this->mFaces);
+    if (this->mPeriodic)
+        faces.insert(faces.end(), this->mPeriodicFaces.begin(), this->mPeriodicFaces.end());
+
+    const size_t nfaces = faces.size();
+
+    std::vector<Triplet> triplets;
+    std::shared_ptr<SparseMatrix> A;
+
+    switch (op) {
+
+        case OP_LAPLACIAN:
+            cotan_laplacian(this->mVertices, faces, this->mPeriodic, boxw, triplets);
+            A = std::make_shared<SparseMatrix>(nverts, nverts, triplets);
+            break;
+
+        case OP_MASS_LUMPED: {
+            const std::vector<TypeFunction> &areas = this->need_pointareas();
+            triplets.reserve(nverts);
+            for(size_t i = 0; i < nverts; i++)
+                triplets.push_back(Triplet(TypeIndex(i), TypeIndex(i), areas[i]));
+            A = std::make_shared<SparseMatrix>(nverts, nverts, triplets);
+            break;
+        }
+
+        case OP_MASS:
+            mass_matrix(this->mVertices, faces, this->mPeriodic, boxw, triplets);
+            A = std::make_shared<SparseMatrix>(nverts, nverts, triplets);
+            break;
+
+        case OP_GRADIENT:
+            hat_gradients(this->mVertices, faces, this->mPeriodic, boxw, false,
+                          [](const double) { return 1.0; }, triplets);
+            A = std::make_shared<SparseMatrix>(3*nfaces, nverts, triplets);
+            break;
+
+        case OP_DIVERGENCE:
+            hat_gradients(this->mVertices, faces, this->mPeriodic, boxw, true,
+                          [](const double area) { return -area; }, triplets);
+            A = std::make_shared<SparseMatrix>(nverts, 3*nfaces, triplets);
+            break;
+    }
+
+    this->mOperators[op] = A;
+    stamp(key);
+
+    if (verbose)
+        std::cout << " Done! (" << A->nnz() << " nonzeros)\n";
+    return *A;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+
+SparseMatrix TriMesh::get_operator(const std::string &name, bool verbose) {
+    return need_operator(operator_index(name), verbose);
+}
+
+std::vector<TypeFunction> TriMesh::apply_operator(const std::string &name, const std::string &field,
+                                                  const std::string &out, bool verbose) {
+
+    const SparseMatrix &A = need_operator(operator_index(name), verbose);
+
+    auto fiter = mFields.find(field);
+    if (fiter == mFields.end() || fiter->second.size() != A.ncols()) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::apply_operator(" << name << "): Field " << field
+               << " not found (or does not have " << A.ncols() << " values)!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    if (verbose) {
+        std::cout << "   > " << tag() << "::apply_operator(" << name << ", " << field << ")...";
+        fflush(stdout);
+    }
+
+    std::vector<TypeFunction> result;
+    Numa::fill(result, A.nrows(), [](const size_t) { return TypeFunction(0); });
+    A.multiply(fiter->second.data(), result.data());
+
+    this->mFields[out] = result;
+    stamp(out);
+
+    if (verbose)
+        std::cout << " Done!\n";
+    return result;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
@@ -0,0 +1,211 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+#include "TriMesh.hpp"
+#include "CellList.hpp"
+#include "DistanceKernels.hpp"
+
+/// -----------------------------------------------------------------------------
+//! the points (given by an accessor) within radius (in xy) of any of the centers
+//!     the centers are binned in a cell list of cell size radius, so every point
+//!     tests only the centers in its neighboring cells
+/// -----------------------------------------------------------------------------
+
+template <typename Point>
+static void roi_points(const std::vector<Vertex> &centers, const TypeFunction radius,
+                       const DistanceKernel &dist, const size_t npoints, Point point,
+                       std::vector<TypeIndexI> &ids) {
+
+    ids.clear();
+    if (centers.empty() || npoints == 0)
+        return;
+
+    const CellList cells(centers, std::vector<TypeIndexI>(), dist, 2, radius);
+    std::vector<uint8_t> mask (npoints, 0);
+
+    #pragma omp parallel
+    {
+    std::vector<std::pair<TypeIndex, TypeFunction>> nbrs;
+
+    #pragma omp for schedule(static)
+    for(TypeIndexI i = 0; i < TypeIndexI(npoints); i++) {
+        cells.radius(point(i), radius, nbrs);
+        mask[i] = nbrs.empty() ? 0 : 1;
+    }
+    }
+
+    for(size_t i = 0; i < npoints; i++) {
+        if (mask[i])
+            ids.push_back(TypeIndexI(i));
+    }
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
+
+void TriMesh::set_roi(float *_, int n, int d, const float radius) {
+
+    if (d < 2 || n <= 0) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::set_roi(): Need a nonempty set of 2D or 3D centers (got "
+               << n << " x " << d << ")!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (!(radius > 0)) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::set_roi(): Invalid radius (" << radius << ")!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+    if (this->mPeriodic && !this->bbox_valid) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::set_roi(): Bounding box not available!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    this->mROICenters.resize(n);
+    for(int i = 0; i < n; i++)
+        this->mROICenters[i] = Vertex(_[d*i], _[d*i+1], 0);
+    this->mROIRadius = radius;
+    this->mROIGiven = false;
+
+    // the properties restricted to the region were computed for a different one
+    this->roi_changed();
+}
+
+void TriMesh::clear_roi() {
+
+    if (!this->has_roi())
+        return;
+
+    this->mROICenters.clear();
+    this->mROIGiven = false;
+    this->mROI.clear();
+    this->roi_changed();
+}
+
+void TriMesh::set_roi_vertices(int *_, int n) {
+
+    const size_t nverts = this->mVertices.size();
+    for(int i = 0; i < n; i++) {
+        if (_[i] < 0 || size_t(_[i]) >= nverts) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::set_roi_vertices(): Invalid vertex (" << _[i] << "); there are "
+                   << nverts << " vertices!" << std::endl;
+            throw std::invalid_argument(errMsg.str());
+        }
+    }
+
+    this->mROICenters.clear();
+    this->mROIGiven = true;
+
+    // (sorted, as the region given by centers)
+    this->mROI.assign(_, _+n);
+    std::sort(this->mROI.begin(), this->mROI.end());
+    this->mROI.erase(std::unique(this->mROI.begin(), this->mROI.end()), this->mROI.end());
+    this->roi_changed();
+}
+
+/// -----------------------------------------------------------------------------
+
+std::vector<TypeIndexI> TriMesh::roi_vertices() const {
+
+    if (this->mROIGiven)
+        return this->mROI;
+
+    std::unique_ptr<DistanceKernel> dist;
+    if (this->mPeriodic)    dist.reset(new DistancePeriodicXYSquared(this->mBox0, this->mBox1));
+    else                    dist.reset(new DistanceSquared());
+
+    const std::vector<Vertex> &vertices = this->mVertices;
+
+    std::vector<TypeIndexI> ids;
+    roi_points(this->mROICenters, this->mROIRadius, *dist, vertices.size(),
+               [&vertices](const TypeIndexI i) { return Vertex(vertices[i][0], vertices[i][1], 0); }, ids);
+    return ids;
+}
+
+const std::vector<TypeIndexI>& TriMesh::need_roi() {
+
+    if (!this->has_roi()) {
+        this->mROI.clear();
+        return this->mROI;
+    }
+
+    // the given vertices are kept (the mesh may have been changed since)
+    if (this->mROIGiven) {
+        if (!this->mROI.empty() && size_t(this->mROI.back()) >= this->mVertices.size()) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::need_roi(): the region has vertices that do not exist anymore!" << std::endl;
+            throw std::logic_error(errMsg.str());
+        }
+        return this->mROI;
+    }
+    if (!is_current("_roi")) {
+        this->mROI = roi_vertices();
+        stamp("_roi", true);
+    }
+    return this->mROI;
+}
+
+std::vector<TypeIndexI> TriMesh::get_roi() {
+
+    if (this->has_roi())
+        return need_roi();
+
+    std::vector<TypeIndexI> ids (this->mVertices.size());
+    for(size_t i = 0; i < ids.size(); i++)
+        ids[i] = TypeIndexI(i);
+    return ids;
+}
+
+std::vector<TypeIndexI> TriMesh::in_roi(float *_, int n, int d) const {
+
+    if (d < 2) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::in_roi(): Need 2D or 3D points (got " << d << "D)!" << std::endl;
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    if (this->mROIGiven) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::in_roi(): not available for a region given by vertices!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    std::vector<TypeIndexI> ids;
+    if (!this->has_roi()) {
+        ids.resize(n);
+        for(int i = 0; i < n; i++)
+            ids[i] = i;
+        return ids;
+    }
+
+    std::unique_ptr<DistanceKernel> dist;
+    if (this->mPeriodic)    dist.reset(new DistancePeriodicXYSquared(this->mBox0, this->mBox1));
+    else                    dist.reset(new DistanceSquared());
+
+    roi_points(this->mROICenters, this->mROIRadius, *dist, size_t(n),
+               [_, d](const TypeIndexI i) { return Vertex(_[d*i], _[d*i+1], 0); }, ids);
+    return ids;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
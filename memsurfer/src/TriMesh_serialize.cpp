@@ -0,0 +1,287 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <tuple>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <sstream>
+#include <stdexcept>
+
+#include "TriMesh.hpp"
+#include "Serialization.hpp"
+
+static const uint32_t TM_MAGIC = 0x4d54534d;       // "MSTM"
+static const uint32_t TM_VERSION = 1;
+
+/// -----------------------------------------------------------------------------
+//! binary layout
+//!     magic, version, dim, periodic, bbox_valid, bbox,
+//!     vertices, faces, delaunay faces (id, offx, offy per corner),
+//!     periodic faces, trimmed faces, duplicates (id, offx, offy), duplicate vertices,
+//!     normals (if current), fields (only the ones that are current)
+/// -----------------------------------------------------------------------------
+
+void TriMesh::serialize(ByteWriter &writer) const {
+
+    writer.write(TM_MAGIC);
+    writer.write(TM_VERSION);
+
+    writer.write(uint8_t(this->mDim));
+    writer.write(uint8_t(this->mPeriodic));
+    writer.write(uint8_t(this->bbox_valid));
+    writer.write(this->mBox0);
+    writer.write(this->mBox1);
+
+    writer.write(this->mVertices);
+    writer.write(this->mFaces);
+
+    // periodic vertices are flattened as (id, offx, offy)
+    std::vector<TypeIndexI> pverts;
+    pverts.reserve(9*mDelaunayFaces.size());
+    for(auto fiter = mDelaunayFaces.begin(); fiter != mDelaunayFaces.end(); fiter++) {
+    for(auto viter = fiter->begin(); viter != fiter->end(); viter++) {
+        pverts.push_back(TypeIndexI(std::get<0>(*viter)));
+        pverts.push_back(std::get<1>(*viter));
+        pverts.push_back(std::get<2>(*viter));
+    }
+    }
+    writer.write(pverts);
+
+    writer.write(this->mPeriodicFaces);
+    writer.write(this->mTrimmedFaces);
+
+    pverts.clear();
+    for(auto viter = mDuplicateVertex_periodic.begin(); viter != mDuplicateVertex_periodic.end(); viter++) {
+        pverts.push_back(TypeIndexI(std::get<0>(*viter)));
+        pverts.push_back(std::get<1>(*viter));
+        pverts.push_back(std::get<2>(*viter));
+    }
+    writer.write(pverts);
+    writer.write(this->mDuplicateVerts);
+
+    // normals
+    const bool has_normals = is_current("_normals");
+    writer.write(uint8_t(has_normals));
+    if (has_normals) {
+        writer.write(this->mPointNormals);
+        writer.write(this->mFaceNormals);
+    }
+
+    // fields
+    uint64_t nfields = 0;
+    for(auto iter = mFields.begin(); iter != mFields.end(); iter++) {
+        nfields += is_current(iter->first) ? 1 : 0;
+    }
+    writer.write(nfields);
+    for(auto iter = mFields.begin(); iter != mFields.end(); iter++) {
+        if (!is_current(iter->first))
+            continue;
+        writer.write(iter->first);
+        writer.write(iter->second);
+    }
+}
+
+/// -----------------------------------------------------------------------------
+size_t TriMesh::serialized_size() const {
+    ByteWriter writer;
+    this->serialize(writer);
+    return writer.size();
+}
+
+size_t TriMesh::serialize(uint8_t *_, size_t n) const {
+    ByteWriter writer(_, n);
+    this->serialize(writer);
+    return writer.size();
+}
+
+/// -----------------------------------------------------------------------------
+//! checks that every corner of the given faces indexes one of the n vertices
+template <typename T>
+static void validate_faces(const std::vector<T> &faces, const size_t n, const std::string &what) {
+
+    for(size_t i = 0; i < faces.size(); i++) {
+    for(uint8_t d = 0; d < 3; d++) {
+        if (size_t(faces[i][d]) >= n) {
+            std::ostringstream errMsg;
+            errMsg << " TriMesh::deserialize(): Invalid " << what << " " << i << " (vertex " << faces[i][d] << " of " << n << ")!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+    }
+    }
+}
+
+/// -----------------------------------------------------------------------------
+//! the buffer is read and validated completely before the mesh is modified,
+//!     so an invalid buffer leaves the mesh untouched
+/// -----------------------------------------------------------------------------
+
+bool TriMesh::deserialize(const uint8_t *buffer, size_t nbytes) {
+
+    ByteReader reader(buffer, nbytes);
+
+    uint32_t magic = 0, version = 0;
+    reader.read(magic);
+    reader.read(version);
+    if (magic != TM_MAGIC || version != TM_VERSION) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::deserialize(): Invalid buffer (magic = " << magic << ", version = " << version << ")!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    uint8_t dim = 0, periodic = 0, bbvalid = 0;
+    reader.read(dim);
+    reader.read(periodic);
+    reader.read(bbvalid);
+
+    Vertex box0, box1;
+    reader.read(box0);
+    reader.read(box1);
+
+    std::vector<Vertex> vertices;
+    std::vector<Face> faces;
+    reader.read(vertices);
+    reader.read(faces);
+
+    const size_t nverts = vertices.size();
+    validate_faces(faces, nverts, "face");
+
+    std::vector<TypeIndexI> pverts;
+    reader.read(pverts);
+    if (pverts.size() % 9 != 0) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::deserialize(): Invalid delaunay faces (" << pverts.size() << " values)!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    const size_t ndfaces = pverts.size() / 9;
+    std::vector<std::vector<periodicVertex> > dfaces(ndfaces);
+    for(size_t i = 0; i < ndfaces; i++) {
+        std::vector<periodicVertex> &dface = dfaces[i];
+        dface.resize(3);
+        for(uint8_t d = 0; d < 3; d++) {
+            const TypeIndexI *p = &pverts[9*i + 3*d];
+            if (p[0] < 0 || size_t(p[0]) >= nverts) {
+                std::ostringstream errMsg;
+                errMsg << " " << this->tag() << "::deserialize(): Invalid delaunay face " << i << " (vertex " << p[0] << " of " << nverts << ")!\n";
+                throw std::invalid_argument(errMsg.str());
+            }
+            dface[d] = periodicVertex(TypeIndex(p[0]), p[1], p[2]);
+        }
+    }
+
+    std::vector<Face> pfaces, tfaces;
+    reader.read(pfaces);
+    reader.read(tfaces);
+
+    reader.read(pverts);
+    if (pverts.size() % 3 != 0) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::deserialize(): Invalid duplicate vertices (" << pverts.size() << " values)!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    const size_t ndups = pverts.size() / 3;
+    std::vector<periodicVertex> dups(ndups);
+    for(size_t i = 0; i < ndups; i++) {
+        if (pverts[3*i] < 0 || size_t(pverts[3*i]) >= nverts) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::deserialize(): Invalid duplicate vertex " << i << " (vertex " << pverts[3*i] << " of " << nverts << ")!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+        dups[i] = periodicVertex(TypeIndex(pverts[3*i]), pverts[3*i+1], pverts[3*i+2]);
+    }
+
+    std::vector<Vertex> dverts;
+    reader.read(dverts);
+    if (dverts.size() != ndups) {
+        std::ostringstream errMsg;
+        errMsg << " " << this->tag() << "::deserialize(): Invalid duplicate vertices (" << dverts.size() << " != " << ndups << ")!\n";
+        throw std::invalid_argument(errMsg.str());
+    }
+
+    // periodic faces use the original vertices, trimmed faces also the duplicates
+    validate_faces(pfaces, nverts, "periodic face");
+    validate_faces(tfaces, nverts + ndups, "trimmed face");
+
+    uint8_t has_normals = 0;
+    std::vector<Normal> pnormals, fnormals;
+    reader.read(has_normals);
+    if (has_normals) {
+        reader.read(pnormals);
+        reader.read(fnormals);
+        if (pnormals.size() != nverts || fnormals.size() != faces.size()) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::deserialize(): Invalid normals (" << pnormals.size() << ", " << fnormals.size() << ")!\n";
+            throw std::invalid_argument(errMsg.str());
+        }
+    }
+
+    uint64_t nfields = 0;
+    reader.read(nfields);
+    std::unordered_map<std::string, std::vector<TypeFunction>> fields;
+    for(uint64_t i = 0; i < nfields; i++) {
+        std::string name;
+        reader.read(name);
+        reader.read(fields[name]);
+    }
+
+    // the buffer is valid: swap in the loaded mesh
+    this->mDim = dim;
+    this->mPeriodic = bool(periodic);
+    this->bbox_valid = bool(bbvalid);
+    this->mBox0 = box0;
+    this->mBox1 = box1;
+
+    this->mVertices.swap(vertices);
+    this->mFaces.swap(faces);
+    this->mDelaunayFaces.swap(dfaces);
+    this->mPeriodicFaces.swap(pfaces);
+    this->mTrimmedFaces.swap(tfaces);
+    this->mDuplicateVertex_periodic.swap(dups);
+    this->mDuplicateVerts.swap(dverts);
+    this->mPointNormals.swap(pnormals);
+    this->mFaceNormals.swap(fnormals);
+    this->mFields.swap(fields);
+
+    // and drop everything derived from the previous one
+    this->mVNeighbors.clear();
+    this->mVAdjFaces.clear();
+    this->mFAcrossEdge.clear();
+    this->bedges.clear();
+    this->mgeodesics.clear();
+    this->mHeat.reset();
+    for(uint8_t i = 0; i < NOPERATORS; i++)
+        this->mOperators[i].reset();
+
+    this->mROICenters.clear();
+    this->mROIRadius = 0;
+    this->mROIGiven = false;
+    this->mROI.clear();
+
+    // the loaded mesh is a new geometry, topology, and region of interest
+    this->geometry_changed();
+    this->topology_changed();
+    this->roi_changed();
+    this->mStamps.clear();
+
+    if (has_normals)
+        stamp("_normals");
+    for(auto iter = mFields.begin(); iter != mFields.end(); iter++)
+        stamp(iter->first);
+    return true;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
@@ -0,0 +1,402 @@
+/**
+Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+Produced at the Lawrence Livermore National Laboratory.
+Written by Harsh Bhatia (hbhatia@llnl.gov) and Peer-Timo Bremer (bremer5@llnl.gov)
+LLNL-CODE-763493. All rights reserved.
+
+This file is part of MemSurfer, Version 1.0.
+Released under GNU General Public License 3.0.
+For details, see https://github.com/LLNL/MemSurfer.
+*/
+
+/// ----------------------------------------------------------------------------
+/// ----------------------------------------------------------------------------
+
+#include <cmath>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TriMesh.hpp"
+#include "Periodic.hpp"
+
+/// -----------------------------------------------------------------------------
+//! the (planar) triangulation of a source mesh, located by walking (or binning)
+/// -----------------------------------------------------------------------------
+
+class PlanarLocator {
+
+    bool periodic;
+    Vertex box0, boxw;
+
+    //! the faces, with their corners unwrapped (in xy) with respect to the first
+    const std::vector<Face> &faces;
+    std::vector<Vertex> corners;
+
+    //! for each face, the faces across its edges (-1 on the boundary)
+    std::vector<Offset3> across;
+
+    //! the faces sorted along a Morton curve (of their centroids), to seed walks
+    Vertex grid0, gridw;
+    std::vector<std::pair<uint32_t, TypeIndex>> seeds;
+
+    //! the faces binned into a uniform ng x ng grid (over the same extent), to scan
+    int ng;
+    std::vector<TypeIndex> binoffsets, binned;
+
+    inline int cell(const TypeFunction x, const uint8_t d) const {
+        const TypeFunction cw = std::max(gridw[d], TypeFunction(1e-6)) / ng;
+        return int(std::floor((x - grid0[d]) / cw));
+    }
+    inline int wrap(const int c) const {
+        if (periodic)   return ((c % ng) + ng) % ng;
+        return std::min(std::max(c, 0), ng-1);
+    }
+
+    //! the closest image of a point to a face
+    inline void image(const TypeIndex fidx, TypeFunction &x, TypeFunction &y) const {
+        if (!periodic)
+            return;
+        const Vertex &p0 = corners[3*fidx];
+        x += boxw[0] * std::round((p0[0] - x) / boxw[0]);
+        y += boxw[1] * std::round((p0[1] - y) / boxw[1]);
+    }
+
+    //! barycentric coordinates of a point in a face (false if degenerate)
+    inline bool bary(const TypeIndex fidx, TypeFunction x, TypeFunction y, TypeFunction w[3]) const {
+
+        image(fidx, x, y);
+        const Vertex *p = &corners[3*fidx];
+
+        const TypeFunction det = (p[1][1]-p[2][1])*(p[0][0]-p[2][0]) + (p[2][0]-p[1][0])*(p[0][1]-p[2][1]);
+        if (std::fabs(det) < 1e-12)
+            return false;
+
+        w[0] = ((p[1][1]-p[2][1])*(x-p[2][0]) + (p[2][0]-p[1][0])*(y-p[2][1])) / det;
+        w[1] = ((p[2][1]-p[0][1])*(x-p[2][0]) + (p[0][0]-p[2][0])*(y-p[2][1])) / det;
+        w[2] = 1.0 - w[0] - w[1];
+        return true;
+    }
+
+public:
+
+    static constexpr TypeFunction eps = 1e-5;
+
+    PlanarLocator(const std::vector<Face> &_faces, const std::vector<Vertex> &vertices,
+                  const bool _periodic, const Vertex &_box0, const Vertex &_box1) :
+        periodic(_periodic), box0(_box0), boxw(_box1 - _box0), faces(_faces) {
+
+        const size_t nfaces = faces.size();
+
+        // ---------------------------------------------------------------------
+        // unwrap the faces
+        corners.resize(3*nfaces);
+        for(size_t i = 0; i < nfaces; i++) {
+            unwrap_face(faces[i], vertices, periodic, boxw, &corners[3*i]);
+        }
+
+        // ---------------------------------------------------------------------
+        // pair the half edges (sorted by their vertices)
+        std::vector<std::pair<uint64_t, TypeIndex>> hedges (3*nfaces);
+        for(size_t i = 0; i < nfaces; i++) {
+        for(uint8_t k = 0; k < 3; k++) {
+            const uint64_t a = faces[i][(k+1)%3], b = faces[i][(k+2)%3];
+            hedges[3*i+k] = std::make_pair((std::min(a,b) << 32) | std::max(a,b), TypeIndex(3*i+k));
+        }}
+        std::sort(hedges.begin(), hedges.end());
+
+        across.assign(nfaces, Offset3(-1,-1,-1));
+        for(size_t h = 0; h+1 < hedges.size(); h++) {
+            if (hedges[h].first != hedges[h+1].first)
+                continue;
+            const TypeIndex h0 = hedges[h].second, h1 = hedges[h+1].second;
+            across[h0/3][h0%3] = TypeIndexI(h1/3);
+            across[h1/3][h1%3] = TypeIndexI(h0/3);
+            h++;
+        }
+
+        // ---------------------------------------------------------------------
+        // sort the faces along the Morton curve
+        if (periodic) {
+            grid0 = box0;
+            gridw = boxw;
+        }
+        else {
+            Vertex g1 = vertices.front();
+            grid0 = g1;
+            for(auto iter = vertices.begin(); iter != vertices.end(); iter++) {
+                grid0.min(*iter);
+                g1.max(*iter);
+            }
+            gridw = g1 - grid0;
+        }
+
+        seeds.resize(nfaces);
+        for(size_t i = 0; i < nfaces; i++) {
+            const Vertex *p = &corners[3*i];
+            seeds[i] = std::make_pair(morton(p[0][0]+p[1][0]+p[2][0], p[0][1]+p[1][1]+p[2][1], 3), TypeIndex(i));
+        }
+        std::sort(seeds.begin(), seeds.end());
+
+        // ---------------------------------------------------------------------
+        // bin the faces (by the bounding boxes of their unwrapped corners)
+        ng = std::max(1, int(std::sqrt(0.5*TypeFunction(nfaces))));
+        binoffsets.assign(size_t(ng)*ng + 1, 0);
+
+        for(uint8_t pass = 0; pass < 2; pass++) {
+
+            std::vector<TypeIndex> fill;
+            if (pass == 1) {
+                for(size_t c = 0; c < size_t(ng)*ng; c++)
+                    binoffsets[c+1] += binoffsets[c];
+                binned.resize(binoffsets.back());
+                fill.assign(binoffsets.begin(), binoffsets.end()-1);
+            }
+
+            for(size_t i = 0; i < nfaces; i++) {
+
+                const Vertex *p = &corners[3*i];
+                const int i0 = cell(std::min(p[0][0], std::min(p[1][0], p[2][0])), 0);
+                const int i1 = cell(std::max(p[0][0], std::max(p[1][0], p[2][0])), 0);
+                const int j0 = cell(std::min(p[0][1], std::min(p[1][1], p[2][1])), 1);
+                const int j1 = cell(std::max(p[0][1], std::max(p[1][1], p[2][1])), 1);
+
+                for(int cj = j0; cj <= j1; cj++) {
+                for(int ci = i0; ci <= i1; ci++) {
+                    const size_t c = size_t(wrap(cj))*ng + wrap(ci);
+                    if (pass == 0)      binoffsets[c+1]++;
+                    else                binned[fill[c]++] = TypeIndex(i);
+                }}
+            }
+        }
+    }
+
+    //! -----------------------------------------------------------------------------
+    //! the Morton code of a point, (x,y) / scale, on a 2^16 x 2^16 grid
+    uint32_t morton(TypeFunction x, TypeFunction y, const TypeFunction scale = 1) const {
+
+        uint32_t code = 0;
+        const TypeFunction c[2] = {x/scale, y/scale};
+        uint32_t g[2];
+        for(uint8_t d = 0; d < 2; d++) {
+            TypeFunction t = (gridw[d] > 0) ? (c[d] - grid0[d]) / gridw[d] : 0;
+            if (periodic)
+                t -= std::floor(t);
+            g[d] = uint32_t(std::min(std::max(t, TypeFunction(0)), TypeFunction(1)) * 65535.0);
+        }
+        for(uint8_t b = 0; b < 16; b++) {
+            code |= ((g[0] >> b) & 1u) << (2*b);
+            code |= ((g[1] >> b) & 1u) << (2*b+1);
+        }
+        return code;
+    }
+
+    //! a face close to a point (along the Morton curve)
+    TypeIndex seed(const TypeFunction x, const TypeFunction y) const {
+        auto iter = std::lower_bound(seeds.begin(), seeds.end(), std::make_pair(morton(x,y), TypeIndex(0)));
+        if (iter == seeds.end())
+            iter--;
+        return iter->second;
+    }
+
+    //! -----------------------------------------------------------------------------
+    //! visibility walk from a face to the face containing a point
+    //!     crosses an edge that separates the face from the point (starting the
+    //!     search at a rotating edge, which avoids cycles in non-Delaunay meshes)
+    //!     returns -1 if the walk leaves the mesh (outside, if the mesh is convex
+    //!     in xy, as a Delaunay triangulation), and -2 if it fails (in both cases,
+    //!     the point is then scanned)
+    TypeIndexI walk(TypeIndex fidx, const TypeFunction x, const TypeFunction y, TypeFunction w[3]) const {
+
+        const size_t maxsteps = 64 + 4*size_t(std::sqrt(TypeFunction(faces.size())));
+        for(size_t s = 0; s < maxsteps; s++) {
+
+            const bool valid = bary(fidx, x, y, w);
+
+            TypeIndexI next = -2;
+            for(uint8_t k = 0; k < 3; k++) {
+                const uint8_t e = (s+k)%3;
+                if (!valid || w[e] < -eps) {
+                    next = across[fidx][e];
+                    break;
+                }
+            }
+            if (next == -2)
+                return TypeIndexI(fidx);
+            if (next == -1)
+                return -1;
+            fidx = TypeIndex(next);
+        }
+        return -2;
+    }
+
+    //! test the faces binned with a point (for the points where the walk fails)
+    TypeIndexI scan(TypeFunction x, TypeFunction y, TypeFunction w[3]) const {
+
+        if (periodic) {
+            x -= boxw[0] * std::floor((x - box0[0]) / boxw[0]);
+            y -= boxw[1] * std::floor((y - box0[1]) / boxw[1]);
+        }
+
+        const size_t c = size_t(wrap(cell(y, 1)))*ng + wrap(cell(x, 0));
+        for(TypeIndex b = binoffsets[c]; b < binoffsets[c+1]; b++) {
+            const TypeIndex fidx = binned[b];
+            if (bary(fidx, x, y, w) && w[0] >= -eps && w[1] >= -eps && w[2] >= -eps)
+                return TypeIndexI(fidx);
+        }
+        return -1;
+    }
+};
+
+/// -----------------------------------------------------------------------------
+//! the fields this mesh caches itself (e.g., need_pointareas, need_curvature)
+/// -----------------------------------------------------------------------------
+
+static bool is_cached_field(const std::string &name) {
+    return name.empty() || name[0] == '_' || name == "point_areas" ||
+           name == "curv_mean" || name == "curv_gauss" || name == "area_power" ||
+           name.compare(0, 5, "tilt_") == 0;
+}
+
+/// -----------------------------------------------------------------------------
+//! resample fields of another mesh at the vertices of this mesh
+//!     the vertices are sorted along a Morton curve and located in chunks (in
+//!     parallel), every walk starting from the face found for the previous
+//!     vertex of the chunk (a vertex where the walk fails or leaves the mesh is
+//!     tested against the binned faces); the fields are then interpolated
+//!     barycentrically
+/// -----------------------------------------------------------------------------
+
+std::vector<std::string>
+TriMesh::transfer_fields(const TriMesh &from, const std::vector<std::string> &names,
+                         const std::string &prefix, bool verbose) {
+
+    if (from.mPeriodic && !from.bbox_valid) {
+        std::ostringstream errMsg;
+        errMsg << " " << from.tag() << "::transfer_fields(): Bounding box not available!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+    if (from.mFaces.empty()) {
+        std::ostringstream errMsg;
+        errMsg << " " << from.tag() << "::transfer_fields(): Mesh has no faces!" << std::endl;
+        throw std::logic_error(errMsg.str());
+    }
+
+    // the fields to transfer (all vertex fields of the other mesh if none given)
+    std::vector<std::string> keys (names);
+    if (keys.empty()) {
+        for(auto iter = from.mFields.begin(); iter != from.mFields.end(); iter++) {
+            if (iter->second.size() == from.mVertices.size())
+                keys.push_back(iter->first);
+        }
+        std::sort(keys.begin(), keys.end());
+    }
+
+    std::vector<const std::vector<TypeFunction>*> fields;
+    for(auto iter = keys.begin(); iter != keys.end(); iter++) {
+        auto fiter = from.mFields.find(*iter);
+        if (fiter == from.mFields.end() || fiter->second.size() != from.mVertices.size()) {
+            std::ostringstream errMsg;
+            errMsg << " " << from.tag() << "::transfer_fields(" << *iter << "): Field not found!" << std::endl;
+            throw std::invalid_argument(errMsg.str());
+        }
+        fields.push_back(&fiter->second);
+
+        // the results must not replace (and validate) the caches of this mesh
+        if (is_cached_field(prefix + *iter)) {
+            std::ostringstream errMsg;
+            errMsg << " " << this->tag() << "::transfer_fields(" << *iter << "): Cannot overwrite the cached field \"" << prefix + *iter << "\"!" << std::endl;
+            throw std::invalid_argument(errMsg.str());
+        }
+    }
+
+    if (verbose) {
+        std::cout << "   > " << tag() << "::transfer_fields(" << keys.size() << " fields)...";
+        fflush(stdout);
+    }
+
+    // -------------------------------------------------------------------------
+    std::vector<Face> faces (from.mFaces);
+    if (from.mPeriodic)
+        faces.insert(faces.end(), from.mPeriodicFaces.begin(), from.mPeriodicFaces.end());
+
+    const PlanarLocator locator (faces, from.mVertices, from.mPeriodic, from.mBox0, from.mBox1);
+
+    // sort the queries spatially
+    const size_t nverts = this->mVertices.size();
+    std::vector<std::pair<uint32_t, TypeIndex>> order (nverts);
+
+    #pragma omp parallel for
+    for(TypeIndexI i = 0; i < TypeIndexI(nverts); i++) {
+        order[i] = std::make_pair(locator.morton(mVertices[i][0], mVertices[i][1]), TypeIndex(i));
+    }
+    std::sort(order.begin(), order.end());
+
+    // -------------------------------------------------------------------------
+    // locate the queries (in chunks of consecutive queries)
+    std::vector<TypeIndexI> located (nverts, -1);
+    std::vector<TypeFunction> weights (3*nverts, 0);
+
+    const TypeIndexI chunk = 256;
+    const TypeIndexI nchunks = TypeIndexI((nverts + chunk - 1) / chunk);
+
+    #pragma omp parallel for schedule(dynamic)
+    for(TypeIndexI c = 0; c < nchunks; c++) {
+
+        const size_t b = size_t(c)*chunk, e = std::min(nverts, b + chunk);
+
+        TypeIndex hint = locator.seed(mVertices[order[b].second][0], mVertices[order[b].second][1]);
+        for(size_t q = b; q < e; q++) {
+
+            const TypeIndex vidx = order[q].second;
+            const TypeFunction x = mVertices[vidx][0], y = mVertices[vidx][1];
+            TypeFunction *w = &weights[3*vidx];
+
+            // the walk may leave a mesh that is not convex (in xy) at an inside point
+            TypeIndexI fidx = locator.walk(hint, x, y, w);
+            if (fidx < 0)
+                fidx = locator.scan(x, y, w);
+
+            located[vidx] = fidx;
+            if (fidx >= 0)
+                hint = TypeIndex(fidx);
+        }
+    }
+
+    // -------------------------------------------------------------------------
+    // interpolate
+    std::vector<std::vector<TypeFunction>> values (fields.size());
+    for(size_t k = 0; k < fields.size(); k++) {
+
+        const std::vector<TypeFunction> &field = *fields[k];
+        Numa::assign(values[k], nverts, TypeFunction(NAN));
+
+        #pragma omp parallel for
+        for(TypeIndexI i = 0; i < TypeIndexI(nverts); i++) {
+            if (located[i] < 0)
+                continue;
+            const Face &f = faces[located[i]];
+            const TypeFunction *w = &weights[3*i];
+            values[k][i] = w[0]*field[f[0]] + w[1]*field[f[1]] + w[2]*field[f[2]];
+        }
+    }
+
+    std::vector<std::string> outputs;
+    for(size_t k = 0; k < keys.size(); k++) {
+        outputs.push_back(prefix + keys[k]);
+        this->mFields[outputs.back()].swap(values[k]);
+        stamp(outputs.back());
+    }
+
+    if (verbose) {
+        const size_t noutside = size_t(std::count(located.begin(), located.end(), -1));
+        std::cout << " Done! (" << noutside << " vertices outside)\n";
+    }
+    return outputs;
+}
+
+/// -----------------------------------------------------------------------------
+/// -----------------------------------------------------------------------------
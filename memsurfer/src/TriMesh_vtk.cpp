@@ -13,6 +13,7 @@ For details, see https://github.com/LLNL/MemSurfer.
 /// ----------------------------------------------------------------------------
 /// ----------------------------------------------------------------------------
 
+#include <cmath>
 #include "TriMesh.hpp"
 
 #ifdef VTK_AVAILABLE
@@ -39,15 +40,35 @@ std::vector<TypeFunction> TriMesh::need_curvature(bool verbose) {
 
     const size_t nverts = mVertices.size();
 
-    if (mFields.find("curv_mean") == mFields.end()) {
+    if (!is_current("curv_mean") || !is_current("curv_gauss")) {
 
         if (verbose) {
             std::cout << "   > " << this->tag() << "::need_curvature...";
             fflush(stdout);
         }
 
-        std::vector<TypeFunction> curvature_mean(nverts);
-        std::vector<TypeFunction> curvature_Gaussian(nverts);
+        std::vector<TypeFunction> curvature_mean(nverts, NAN);
+        std::vector<TypeFunction> curvature_Gaussian(nverts, NAN);
+
+        // with a region of interest, only the faces around its vertices are needed
+        //  (the curvature at a vertex depends on its star)
+        std::vector<uint8_t> inside (nverts, 1);
+        if (this->has_roi()) {
+            const std::vector<TypeIndexI> &roi = need_roi();
+            inside.assign(nverts, 0);
+            for (auto it = roi.begin(); it != roi.end(); ++it)
+                inside[*it] = 1;
+        }
+
+        std::vector<const Face*> faces;
+        std::vector<vtkIdType> pids (nverts, -1);
+        for (auto it = mFaces.begin(); it != mFaces.end(); ++it) {
+            const Face &f = *it;
+            if (inside[f[0]] || inside[f[1]] || inside[f[2]]) {
+                faces.push_back(&f);
+                pids[f[0]] = pids[f[1]] = pids[f[2]] = 0;
+            }
+        }
 
         // create vtkpolydata object
         vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
@@ -57,15 +78,18 @@ std::vector<TypeFunction> TriMesh::need_curvature(bool verbose) {
         surface->SetPolys(vtkSmartPointer<vtkCellArray>::New());
         surface->SetVerts(vtkSmartPointer<vtkCellArray>::New());
 
-        for (auto it = mVertices.begin(); it != mVertices.end(); ++it) {
-            const Vertex &v = *it;
+        for (size_t i = 0; i < nverts; i++) {
+            if (!inside[i] && pids[i] == -1)
+                continue;
+            const Vertex &v = mVertices[i];
             vtkIdType pid = surface->GetPoints()->InsertNextPoint(v[0], v[1], v[2]);
             surface->GetVerts()->InsertNextCell(1, &pid);
+            pids[i] = pid;
         }
 
-        for (auto it = mFaces.begin(); it != mFaces.end(); ++it) {
-            const Face &f = *it;
-            vtkIdType cell[3] = {f[0], f[1], f[2]};
+        for (auto it = faces.begin(); it != faces.end(); ++it) {
+            const Face &f = **it;
+            vtkIdType cell[3] = {pids[f[0]], pids[f[1]], pids[f[2]]};
             surface->InsertNextCell(VTK_TRIANGLE,3,cell);
         }
 
@@ -80,8 +104,10 @@ std::vector<TypeFunction> TriMesh::need_curvature(bool verbose) {
         gCurvaturesFilter->Update();
 
         for(size_t i = 0; i < mVertices.size(); i++) {
-            curvature_mean[i] = mCurvaturesFilter->GetOutput()->GetPointData()->GetScalars()->GetTuple(i)[0];
-            curvature_Gaussian[i] = gCurvaturesFilter->GetOutput()->GetPointData()->GetScalars()->GetTuple(i)[0];
+            if (!inside[i])
+                continue;
+            curvature_mean[i] = mCurvaturesFilter->GetOutput()->GetPointData()->GetScalars()->GetTuple(pids[i])[0];
+            curvature_Gaussian[i] = gCurvaturesFilter->GetOutput()->GetPointData()->GetScalars()->GetTuple(pids[i])[0];
         }
 
         if(verbose)
@@ -89,6 +115,8 @@ std::vector<TypeFunction> TriMesh::need_curvature(bool verbose) {
 
         mFields["curv_mean"]  = curvature_mean;
         mFields["curv_gauss"] = curvature_Gaussian;
+        stamp("curv_mean", true);
+        stamp("curv_gauss", true);
     }
 
     // return value!
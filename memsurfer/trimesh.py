@@ -111,6 +111,75 @@ class TriMesh(object):
             self.tfaces = np.array(self.tfaces).reshape(-1,3).astype(np.uint32)
             self.dverts = np.array(self.dverts).reshape(-1,self.vertices.shape[1]).astype(np.float32)
 
+    # --------------------------------------------------------------------------
+    def update_vertices(self, vertices):
+        '''
+            Move the vertices in place (e.g., to the next frame of a trajectory)
+                keeps the faces, and reuses all buffers of the mesh
+                properties are recomputed when requested again
+        '''
+        vertices = np.ascontiguousarray(vertices, dtype=np.float32)
+        if vertices.shape != self.vertices.shape:
+            raise ValueError('{} update_vertices expected {}, got {}'
+                             .format(self.tag(), self.vertices.shape, vertices.shape))
+
+        self.vertices[:] = vertices
+        self.tmesh.update_vertices(self.vertices)
+
+        if self.periodic and hasattr(self, 'dverts'):
+            self.dverts = np.array(self.tmesh.duplicated_vertices()).reshape(-1,self.vertices.shape[1]).astype(np.float32)
+
+        self.pnormals = np.empty((0,0))
+        self.pareas = np.empty(0)
+        self.mean_curv = np.empty(0)
+        self.gaus_curv = np.empty(0)
+        self.pverts = np.empty((0,0))
+
+    # --------------------------------------------------------------------------
+    def serialized_size(self):
+        return self.tmesh.serialized_size()
+
+    def serialize(self, buffer=None):
+        '''
+            Serialize the native mesh (pymemsurfer.TriMesh) into buffer: a writable
+                uint8 ndarray of at least serialized_size() bytes (e.g., a view of
+                shared memory), or into a new array if buffer is None
+            the native mesh can be restored with pymemsurfer.TriMesh().deserialize(buffer)
+        '''
+        if buffer is None:
+            buffer = np.empty(self.tmesh.serialized_size(), dtype=np.uint8)
+        nbytes = self.tmesh.serialize(buffer)
+        return buffer[:nbytes]
+
+    # --------------------------------------------------------------------------
+    def memory_usage(self):
+        '''
+            Bytes retained by this mesh: {'numpy': the arrays of this object,
+                'native': the native mesh (incl. fields), 'caches': of which are
+                caches (adjacency, geodesics, heat solver, operators)}
+        '''
+        arrays = ['vertices', 'faces', 'pfaces', 'tfaces', 'dverts', 'pverts',
+                  'pnormals', 'pareas', 'mean_curv', 'gaus_curv']
+        nbytes = sum(getattr(self, a).nbytes for a in arrays
+                     if isinstance(getattr(self, a, None), np.ndarray))
+
+        return {'numpy': nbytes,
+                'native': self.tmesh.memory_usage(False),
+                'caches': self.tmesh.memory_usage(True)}
+
+    def release_caches(self):
+        '''
+            Free the native caches; they are recomputed when needed again
+        '''
+        self.tmesh.release_caches()
+
+    def release_fields(self, keep=[]):
+        '''
+            Free the native fields (e.g., densities), except those in keep
+                the values returned to python are not affected
+        '''
+        self.tmesh.release_fields(list(keep))
+
     # --------------------------------------------------------------------------
     def parameterize(self, xy=False):
 
@@ -222,6 +291,93 @@ class TriMesh(object):
                     .format(self.tag(), mtimer, self.nfaces, self.pfaces.shape[0], self.tfaces.shape[0], self.nverts, self.dverts.shape[0]))
 
 
+    # --------------------------------------------------------------------------
+    def regular(self, weights):
+        '''
+            Compute the 2D regular (weighted Delaunay) triangulation
+                weights: ndarray (nverts,), e.g., the squared radii of the lipids
+            returns the areas of the power cells of the vertices
+        '''
+        weights = np.ascontiguousarray(weights, dtype=np.float32).reshape(-1)
+        if weights.shape[0] != self.nverts:
+            raise ValueError('{} Got {} weights for {} vertices'.format(self.tag(), weights.shape[0], self.nverts))
+
+        tag = ' periodic ' if self.periodic else ' '
+        LOGGER.info('{} Computing 2D{}regular triangulation.'.format(self.tag(), tag))
+        mtimer = Timer()
+
+        faces = self.tmesh.regular(weights, self.cverbose)
+        self.faces = np.array(faces).reshape(-1, 3).astype(np.uint32)
+        self.nfaces = self.faces.shape[0]
+
+        if self.periodic:
+            pfaces = self.tmesh.periodic_faces()
+            self.pfaces = np.array(pfaces).reshape(-1, 3).astype(np.uint32)
+
+            tfaces = self.tmesh.trimmed_faces()
+            self.tfaces = np.array(tfaces).reshape(-1, 3).astype(np.uint32)
+
+            dverts = self.tmesh.duplicated_vertices()
+            self.dverts = np.array(dverts).reshape(-1, self.vertices.shape[1]).astype(np.float32)
+
+        pareas = np.asarray(self.tmesh.get_field('area_power'), dtype=np.float32)
+        mtimer.end()
+
+        LOGGER.info('{} Regular triangulation took {}! created {} faces, and {} vertices ({} hidden).'
+                    .format(self.tag(), mtimer, self.nfaces, self.nverts, np.count_nonzero(pareas == 0)))
+        return pareas
+
+    # --------------------------------------------------------------------------
+    def decimate(self, target_nverts=0, max_error=-1.):
+        '''
+            Decimate the surface using quadric-error edge collapses
+                target_nverts:  stop at this many vertices
+                max_error:      stop before a collapse with a larger (quadric) error
+            boundary vertices are preserved, and all computed properties are reset
+        '''
+        if self.periodic:
+            raise ValueError('{} Cannot decimate a periodic mesh'.format(self.tag()))
+
+        LOGGER.info('{} Decimating the surface with {} vertices and {} faces'
+                    .format(self.tag(), self.nverts, self.nfaces))
+        mtimer = Timer()
+
+        self.tmesh.decimate(int(target_nverts), float(max_error), self.cverbose)
+
+        self.vertices = np.array(self.tmesh.get_vertices()).reshape(-1, 3).astype(np.float32)
+        self.faces = np.array(self.tmesh.get_faces()).reshape(-1, 3).astype(np.uint32)
+        self.nverts = self.vertices.shape[0]
+        self.nfaces = self.faces.shape[0]
+
+        self.pnormals = np.empty((0,0))
+        self.pareas = np.empty(0)
+        self.mean_curv = np.empty(0)
+        self.gaus_curv = np.empty(0)
+        self.pverts = np.empty((0,0))
+
+        mtimer.end()
+        LOGGER.info('{} Decimated to {} vertices and {} faces! took {}'
+                    .format(self.tag(), self.nverts, self.nfaces, mtimer))
+
+    # --------------------------------------------------------------------------
+    def smooth_taubin(self, lam=0.5, mu=-0.53, niters=10):
+        '''
+            Taubin (lambda|mu) smoothing of the vertices (periodic in xy)
+                returns the smoothed vertices; the mesh itself is not modified
+        '''
+        if self.nfaces == 0:
+            raise ValueError('{} Cannot smooth a mesh without faces'.format(self.tag()))
+
+        LOGGER.info('{} Taubin smoothing ({}, {}) for {} iterations'.format(self.tag(), lam, mu, niters))
+        mtimer = Timer()
+
+        svertices = self.tmesh.smooth_taubin(float(lam), float(mu), int(niters), self.cverbose)
+        svertices = np.array(svertices).reshape(-1, 3).astype(np.float32)
+
+        mtimer.end()
+        LOGGER.info('{} Taubin smoothing took {}'.format(self.tag(), mtimer))
+        return svertices
+
     # --------------------------------------------------------------------------
     def compute_normals(self):
 
@@ -287,16 +443,39 @@ class TriMesh(object):
         LOGGER.info('{} Computed {} x2 curvatures! took {}'.format(self.tag(), self.nverts, mtimer))
         return (self.mean_curv, self.gaus_curv)
 
+    # --------------------------------------------------------------------------
+    def compute_tilt(self, heads, tails):
+        '''
+            Compute the tilt of lipids with respect to the point normals
+                heads, tails: ndarray of shape (nverts, 3), paired with the vertices
+            returns the tilt angles (degrees), and the unit in-plane directors (nverts, 3)
+        '''
+        heads = np.ascontiguousarray(heads, dtype=np.float32)
+        tails = np.ascontiguousarray(tails, dtype=np.float32)
+        if heads.shape != (self.nverts, 3) or tails.shape != (self.nverts, 3):
+            raise ValueError('{} compute_tilt expected heads and tails of shape ({}, 3), got {} and {}'
+                             .format(self.tag(), self.nverts, heads.shape, tails.shape))
+
+        LOGGER.info('{} Computing tilt'.format(self.tag()))
+        mtimer = Timer()
+
+        rval = self.tmesh.need_tilt(heads, tails, self.cverbose)
+        rval = np.array(rval, dtype=np.float32).reshape(-1, 4)
+
+        mtimer.end()
+        LOGGER.info('{} Computed {} tilts! took {}'.format(self.tag(), self.nverts, mtimer))
+        return (rval[:,0], rval[:,1:])
+
     # --------------------------------------------------------------------------
     def compute_distance_to_surface(self, other):
         d = self.tmesh.distance_to_other_mesh(other.tmesh)
         return np.asarray(d, dtype=np.float32)
 
     # --------------------------------------------------------------------------
-    def compute_density(self, type, sigma, name, get_nlipids, pidxs):
+    def compute_density(self, type, sigma, name, get_nlipids, pidxs, fast_exp=False, tolerance=0., knn=0):
 
-        if type < 1 or type > 3:
-            raise InvalidArgument('Invalid density type, {}. Should be 1 (geodesic), 2 (2D) or 3 (3D)'.format(type))
+        if type < 1 or type > 5:
+            raise InvalidArgument('Invalid density type, {}. Should be 1 (geodesic), 2 (2D), 3 (3D), 4 (DTFE) or 5 (diffusion)'.format(type))
 
         cnt = self.nverts
         tag = 'all (of {})'.format(cnt)
@@ -310,13 +489,19 @@ class TriMesh(object):
 
         # ----------------------------------------------------------------------
         # based on the type of density, choose the correct kernel!
-        if type == 1 or type == 2:
+        # (DTFE (type 4) is parameter-free and does not use the kernel)
+        if type == 4:
+            dens_kern = pymemsurfer.GaussianKernel2D(1.)
+        elif type == 1 or type == 2 or type == 5:
             dens_kern = pymemsurfer.GaussianKernel2D(float(sigma))
         elif type == 3:
             dens_kern = pymemsurfer.GaussianKernel3D(float(sigma))
         else:
             assert False
 
+        # approximate exp (max rel. error ~1e-7) is faster for large meshes
+        dens_kern.set_fast_exp(fast_exp)
+
         # ----------------------------------------------------------------------
         # based on periodicity, choose the correct distance kernel!
         if self.periodic:
@@ -325,8 +510,20 @@ class TriMesh(object):
             dist_kern = pymemsurfer.DistanceSquared()
 
         # ----------------------------------------------------------------------
+        # tolerance > 0 (types 2 and 3) bounds the relative error of a
+        # (much faster) dual-tree approximation
+        # knn > 0 (types 2 and 3) scales the bandwidth of every point by its
+        # distance to the knn-th nearest point (adaptive density)
+        # (the two cannot be combined)
+        if tolerance < 0:
+            raise ValueError('Invalid tolerance, {}. Should be non-negative'.format(tolerance))
+        if knn < 0 or (knn > 0 and (type == 1 or type >= 4)):
+            raise ValueError('Invalid knn, {}. Adaptive density needs knn > 0 and type 2 or 3'.format(knn))
+        if knn > 0 and tolerance > 0:
+            raise ValueError('Adaptive density (knn = {}) is not available with a tolerance ({})'.format(knn, tolerance))
+
         d = self.tmesh.kde(name, type, get_nlipids, dens_kern, dist_kern,
-                            pidxs.tolist(), self.cverbose)
+                            pidxs.tolist(), float(tolerance), int(knn), self.cverbose)
         d = np.asarray(d, dtype=np.float32)
 
         mtimer.end()
@@ -336,6 +533,115 @@ class TriMesh(object):
         # ----------------------------------------------------------------------
         return d
 
+    # --------------------------------------------------------------------------
+    def interpolate_field(self, name, points):
+        '''
+            Linearly interpolate a field (e.g., a density) at query points
+                points: ndarray of shape (n, 2/3), located in xy
+                returns nan for points outside the mesh
+        '''
+        points = np.ascontiguousarray(points, dtype=np.float32)
+        if len(points.shape) != 2 or points.shape[1] < 2:
+            raise ValueError('Query points should be an ndarray (npoints, 2/3)')
+
+        values = self.tmesh.interpolate_field(name, points)
+        return np.asarray(values, dtype=np.float32)
+
+    def transfer_fields(self, other, names, prefix='xfer_'):
+        '''
+            Resample fields of another mesh (e.g., the previous frame, or the
+            exact surface) at the vertices of this mesh, located in xy
+                names:  list of the fields to transfer (all vertex fields, if empty)
+                prefix: the transferred fields are stored as prefix + name (which may
+                        not be a field this mesh caches, e.g., point_areas)
+                returns a dict of the transferred fields, by their stored names
+                        (nan outside the other mesh)
+        '''
+        LOGGER.info('{} Transferring fields {} from {}'.format(self.tag(), names, other.tag()))
+        mtimer = Timer()
+
+        names = list(names)
+        outputs = self.tmesh.transfer_fields(other.tmesh, names, prefix, self.cverbose)
+        fields = {n: np.asarray(self.tmesh.get_field(n), dtype=np.float32) for n in outputs}
+
+        mtimer.end()
+        LOGGER.info('{} Transferred {} fields! took {}'.format(self.tag(), len(fields), mtimer))
+
+        if len(fields) > 0:
+            noutside = np.count_nonzero(np.isnan(fields[outputs[0]]))
+            if noutside > 0:
+                LOGGER.warning('{} {} vertices are outside {}'.format(self.tag(), noutside, other.tag()))
+
+        return fields
+
+    # --------------------------------------------------------------------------
+    def set_roi(self, centers, radius):
+        '''
+            Restrict the expensive properties to a region of interest: the vertices
+            within radius (in xy, periodic) of any of the centers
+                centers: ndarray of shape (n, 2/3)
+                densities (types 2 and 3) are evaluated only there, curvatures are
+                computed on the faces around it, and distances only for it
+                the properties are nan outside the region
+        '''
+        centers = np.ascontiguousarray(np.atleast_2d(centers), dtype=np.float32)
+        if centers.shape[1] < 2:
+            raise ValueError('ROI centers should be an ndarray (ncenters, 2/3)')
+
+        self.tmesh.set_roi(centers, float(radius))
+        LOGGER.info('{} Set region of interest: {} vertices within {} of {} centers'
+                    .format(self.tag(), len(self.tmesh.get_roi()), radius, centers.shape[0]))
+
+    def set_roi_vertices(self, ids):
+        '''
+            Restrict the expensive properties to the given vertices instead
+                (e.g., those owned by a tile of the domain; see decomposition.py)
+        '''
+        self.tmesh.set_roi_vertices(np.ascontiguousarray(ids, dtype=np.int32))
+
+    def clear_roi(self):
+        self.tmesh.clear_roi()
+
+    def roi_vertices(self):
+        '''
+            The vertices in the region of interest (all, if there is none)
+        '''
+        return np.asarray(self.tmesh.get_roi(), dtype=np.int32)
+
+    def in_roi(self, points):
+        '''
+            The indices of the points (ndarray (n, 2/3)) in the region of interest,
+                e.g., to project only the atoms that are needed
+        '''
+        points = np.ascontiguousarray(points, dtype=np.float32)
+        return np.asarray(self.tmesh.in_roi(points), dtype=np.int32)
+
+    # --------------------------------------------------------------------------
+    def get_operator(self, name):
+        '''
+            A discrete operator of the mesh, built once and cached until the mesh changes
+                name: 'laplacian', 'mass_lumped', 'mass', 'gradient', or 'divergence'
+                the faces are those of periodic_faces(combined=True)
+                returns the csr arrays (values, columns, offsets) and the shape, e.g.,
+                    for scipy.sparse.csr_matrix((values, columns, offsets), shape)
+        '''
+        op = self.tmesh.get_operator(name, self.cverbose)
+        return (np.asarray(op.get_values(), dtype=np.float32),
+                np.asarray(op.get_columns(), dtype=np.int32),
+                np.asarray(op.get_offsets(), dtype=np.int32)), (op.nrows(), op.ncols())
+
+    def apply_operator(self, name, field, out=None):
+        '''
+            Apply a discrete operator (see get_operator) to a field of the mesh
+                the result is stored as the field out (default: name_field)
+                e.g., apply_operator('gradient', 'density') gives 3 values per face
+        '''
+        if out is None:
+            out = '{}_{}'.format(name, field)
+
+        r = self.tmesh.apply_operator(name, field, out, self.cverbose)
+        return np.asarray(r, dtype=np.float32)
+
     # --------------------------------------------------------------------------
     def tag(self):
         return '[{}, periodic={}]'.format(self.label, self.periodic)
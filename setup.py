@@ -17,7 +17,7 @@ import numpy
 
 from pkg_resources import parse_version
 from Cython.Build import cythonize
-from setuptools import find_packages, setup, Extension
+from setuptools import find_packages, setup, Extension, Command
 from setuptools.command.install import install
 from distutils.command.build import build
 
@@ -111,6 +111,62 @@ class CustomInstall(install):
         self.run_command('build_ext')
         self.do_egg_install()
 
+
+class BuildInSitu(Command):
+    '''
+        Build MemSurfer's cpp code as a standalone shared library (libmemsurfer)
+        with the C API of InSitu.h, independent of SWIG and Python
+            python setup.py build_insitu [--build-dir=<dir>] [--test]
+        --test also builds and runs the C smoke test (examples/ex_insitu.c)
+    '''
+    description = 'build the standalone in-situ library (libmemsurfer)'
+    user_options = [('build-dir=', 'b', 'directory for the library'),
+                    ('test', 't', 'build and run the C smoke test')]
+    boolean_options = ['test']
+
+    def initialize_options(self):
+        self.build_dir = None
+        self.test = False
+
+    def finalize_options(self):
+        if self.build_dir is None:
+            self.build_dir = os.path.join('build', 'insitu')
+
+    def run(self):
+        from distutils.ccompiler import new_compiler
+        from distutils.sysconfig import customize_compiler
+
+        compiler = new_compiler()
+        customize_compiler(compiler)
+
+        objs = compiler.compile(LIB_INSITU['sources'], output_dir=self.build_dir,
+                                include_dirs=LIB_INSITU['include_dirs'],
+                                macros=LIB_INSITU['define_macros'],
+                                extra_postargs=LIB_INSITU['extra_compile_args'])
+
+        compiler.link_shared_lib(objs, 'memsurfer', output_dir=self.build_dir,
+                                 libraries=LIB_INSITU['libraries'],
+                                 library_dirs=LIB_INSITU['library_dirs'],
+                                 extra_postargs=['-fopenmp', '-pthread'],
+                                 target_lang='c++')
+        print ('  > built ({})'.format(compiler.library_filename('memsurfer', 'shared', output_dir=self.build_dir)))
+
+        if not self.test:
+            return
+
+        # the smoke test is a C program that links only with the library
+        libdir = os.path.abspath(self.build_dir)
+        objs = compiler.compile([os.path.join('examples', 'ex_insitu.c')], output_dir=self.build_dir,
+                                include_dirs=LIB_INSITU['include_dirs'][:1],
+                                extra_postargs=['-std=c99'])
+        compiler.link_executable(objs, 'ex_insitu', output_dir=self.build_dir,
+                                 libraries=['memsurfer', 'm'],
+                                 library_dirs=[libdir], runtime_library_dirs=[libdir])
+
+        exe = os.path.join(self.build_dir, compiler.executable_filename('ex_insitu'))
+        if subprocess.call([exe]) != 0:
+            raise Exception('The in-situ smoke test ({}) failed!'.format(exe))
+
 # ------------------------------------------------------------------------------
 # main function
 # ------------------------------------------------------------------------------
@@ -157,6 +213,10 @@ if __name__ == '__main__' :
     # cpp code
     INC_MEM = os.path.join(PATH_MEM, 'memsurfer', 'include')
     SRC_MEM = glob.glob(os.path.join(PATH_MEM, 'memsurfer', 'src', '*.cpp'))
+
+    # the C API for in-situ use goes only into the standalone library
+    SRC_INSITU = [s for s in SRC_MEM if os.path.basename(s) == 'InSitu.cpp']
+    SRC_MEM = [s for s in SRC_MEM if os.path.basename(s) != 'InSitu.cpp']
     SRC_MEM.append(os.path.join(PATH_MEM, 'memsurfer', 'pymemsurfer.i'))
 
     # external libs
@@ -188,6 +248,16 @@ if __name__ == '__main__' :
                          extra_link_args=['-std=c++11']
                         )
 
+    # --------------------------------------------------------------------------
+    # standalone library for in-situ use (python setup.py build_insitu)
+    # --------------------------------------------------------------------------
+    LIB_INSITU = {'sources': SRC_MEM[:-1] + SRC_INSITU,
+                  'include_dirs': EXT_MEM.include_dirs,
+                  'libraries': EXT_MEM.libraries,
+                  'library_dirs': EXT_MEM.library_dirs,
+                  'define_macros': EXT_MEM.define_macros,
+                  'extra_compile_args': ['-fPIC', '-fopenmp', '-pthread'] + EXT_MEM.extra_compile_args}
+
     # --------------------------------------------------------------------------
     # --------------------------------------------------------------------------
     # set up!
@@ -203,7 +273,7 @@ if __name__ == '__main__' :
           packages=find_packages(),
           package_data={ 'memsurfer': ['_pymemsurfer.so', 'pypoisson.so'] },
           ext_modules=cythonize([EXT_PP, EXT_MEM]),
-          cmdclass={'build': CustomBuild, 'install': CustomInstall}
+          cmdclass={'build': CustomBuild, 'install': CustomInstall, 'build_insitu': BuildInSitu}
          )
 # ------------------------------------------------------------------------------
 # ------------------------------------------------------------------------------